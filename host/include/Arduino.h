@@ -0,0 +1,124 @@
+// Host build of the subset of the Arduino AVR core used by the firmware.
+// Pins, timing and Serial are backed by the simulator in ../sim.
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "binary.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+
+#define NOT_A_PORT 0
+#define PB 2
+#define PC 3
+#define PD 4
+
+#ifndef F_CPU
+#define F_CPU 8000000L
+#endif
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define abs(x) ((x)>0?(x):-(x))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+#define F(string_literal) (string_literal)
+
+#define noInterrupts() cli()
+#define interrupts() sei()
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+
+// ATmega328p pin map: D0-D7 on PORTD, D8-D13 on PORTB, A0-A5 on PORTC
+uint8_t digitalPinToPort(uint8_t pin);
+uint8_t digitalPinToBitMask(uint8_t pin);
+volatile uint8_t *portOutputRegister(uint8_t port);
+volatile uint8_t *portInputRegister(uint8_t port);
+volatile uint8_t *portModeRegister(uint8_t port);
+
+class Print
+{
+	public:
+		virtual ~Print() {}
+		virtual size_t write(uint8_t c) = 0;
+		virtual size_t write(const uint8_t *buffer, size_t size);
+		size_t write(const char *str) { return write((const uint8_t *) str, strlen(str)); }
+		virtual int availableForWrite() { return 0; }
+
+		size_t print(const char str[]);
+		size_t print(char c);
+		size_t print(unsigned char n, int base = 10);
+		size_t print(int n, int base = 10);
+		size_t print(unsigned int n, int base = 10);
+		size_t print(long n, int base = 10);
+		size_t print(unsigned long n, int base = 10);
+		size_t print(double n, int digits = 2);
+
+		size_t println(void);
+		template <class T> size_t println(T value) { size_t n = print(value); return n + println(); }
+		template <class T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+
+	private:
+		size_t printNumber(unsigned long n, uint8_t base);
+};
+
+class HardwareSerial : public Print
+{
+	public:
+		void begin(unsigned long baud);
+		void end() {}
+		int available(void);
+		int peek(void);
+		int read(void);
+		int availableForWrite(void);
+		void flush(void) {}
+		size_t write(uint8_t c);
+		using Print::write;
+		operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// entry points of the sketch
+void setup(void);
+void loop(void);
+
+#endif
@@ -0,0 +1,52 @@
+// Host model of a single DS18B20 on the bus: conversion times and
+// quantization follow the resolution, the temperature itself comes
+// from the simulator.
+#ifndef DallasTemperature_h
+#define DallasTemperature_h
+
+#include <OneWire.h>
+
+typedef uint8_t DeviceAddress[8];
+
+#define DEVICE_DISCONNECTED_C   -127
+#define DEVICE_DISCONNECTED_F   -196.6
+#define DEVICE_DISCONNECTED_RAW -7040
+
+class DallasTemperature
+{
+	public:
+		DallasTemperature(OneWire *wire);
+
+		void begin(void);
+		uint8_t getDeviceCount(void);
+		bool getAddress(uint8_t *deviceAddress, uint8_t index);
+
+		uint8_t getResolution();
+		uint8_t getResolution(const uint8_t *deviceAddress);
+		void setResolution(uint8_t newResolution);
+		bool setResolution(const uint8_t *deviceAddress, uint8_t newResolution, bool skipGlobalBitResolutionCalculation = false);
+
+		void setWaitForConversion(bool flag) { _waitForConversion = flag; }
+		bool getWaitForConversion(void)      { return _waitForConversion; }
+		void setAutoSaveScratchPad(bool flag) { _autoSaveScratchPad = flag; }
+		bool getAutoSaveScratchPad(void)      { return _autoSaveScratchPad; }
+
+		void requestTemperatures(void);
+		bool requestTemperaturesByAddress(const uint8_t *deviceAddress);
+		bool isConversionComplete(void);
+		int16_t millisToWaitForConversion(uint8_t bitResolution);
+
+		int16_t getTemp(const uint8_t *deviceAddress);
+		float getTempC(const uint8_t *deviceAddress);
+		float getTempCByIndex(uint8_t index);
+
+	private:
+		bool _waitForConversion;
+		bool _autoSaveScratchPad;
+		uint8_t _resolution;
+		unsigned long _conversionStart;
+		int16_t _scratchpad; // 1/128 C, like the library's raw readings
+		bool _converting;
+};
+
+#endif
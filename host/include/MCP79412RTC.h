@@ -0,0 +1,71 @@
+// Host model of the MCP79412 RTC above the I2C layer: the clock runs on
+// simulated time, the MFP output drives the pin it is wired to, and the
+// SRAM and EEPROM keep their contents for the whole run.
+#ifndef MCP79412RTC_h
+#define MCP79412RTC_h
+
+#include <Time.h>
+
+// alarm numbers
+#define ALARM_0 0
+#define ALARM_1 1
+
+// alarm types for enableAlarm()
+#define ALM_MATCH_SECONDS  0
+#define ALM_MATCH_MINUTES  1
+#define ALM_MATCH_HOURS    2
+#define ALM_MATCH_DAY      3 // triggers at midnight
+#define ALM_MATCH_DATE     4 // triggers at midnight
+#define ALM_RESERVED_5     5
+#define ALM_RESERVED_6     6
+#define ALM_MATCH_DATETIME 7
+#define ALM_DISABLE        8
+
+// square-wave frequencies for squareWave()
+#define SQWAVE_1_HZ     0
+#define SQWAVE_4096_HZ  1
+#define SQWAVE_8192_HZ  2
+#define SQWAVE_32768_HZ 3
+#define SQWAVE_NONE     4
+
+#define SRAM_SIZE        64
+#define EEPROM_SIZE      128
+#define EEPROM_PAGE_SIZE 8
+#define EEPROM_WRITE     5 // ms per page write
+
+class MCP79412RTC
+{
+	public:
+		MCP79412RTC();
+
+		static time_t get(void);
+		static void set(time_t t);
+		static bool read(tmElements_t &tm);
+		static void write(tmElements_t &tm);
+
+		void sramWrite(byte addr, byte value);
+		void sramWrite(byte addr, byte *values, byte nBytes);
+		byte sramRead(byte addr);
+		void sramRead(byte addr, byte *values, byte nBytes);
+		void eepromWrite(byte addr, byte value);
+		void eepromWrite(byte addr, byte *values, byte nBytes);
+		byte eepromRead(byte addr);
+		void eepromRead(byte addr, byte *values, byte nBytes);
+
+		int calibRead(void);
+		void calibWrite(int value);
+		void idRead(byte *uniqueID);
+
+		void setAlarm(uint8_t alarmNumber, time_t alarmTime);
+		void enableAlarm(uint8_t alarmNumber, uint8_t alarmType);
+		bool alarm(uint8_t alarmNumber);
+		void out(bool level);
+		void alarmPolarity(bool polarity);
+		bool isRunning(void);
+		void vbaten(bool enable);
+		void squareWave(uint8_t freq);
+};
+
+extern MCP79412RTC RTC;
+
+#endif
@@ -0,0 +1,16 @@
+// The sensor is simulated above the 1-Wire layer, see DallasTemperature.h.
+#ifndef OneWire_h
+#define OneWire_h
+
+#include <Arduino.h>
+
+class OneWire
+{
+	public:
+		OneWire(uint8_t pin) : _pin(pin) {}
+
+	private:
+		uint8_t _pin;
+};
+
+#endif
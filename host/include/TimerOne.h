@@ -0,0 +1,26 @@
+// Host version of the TimerOne API: same period to prescaler/TOP
+// calculation, with the overflow interrupt raised by the simulator.
+#ifndef TimerOne_h
+#define TimerOne_h
+
+#include <Arduino.h>
+
+class TimerOne
+{
+	public:
+		void initialize(unsigned long microseconds = 1000000);
+		void setPeriod(unsigned long microseconds);
+		void start();
+		void stop();
+		void restart();
+		void resume();
+		void attachInterrupt(void (*isr)());
+		void attachInterrupt(void (*isr)(), unsigned long microseconds);
+		void detachInterrupt();
+
+		static void (*isrCallback)();
+};
+
+extern TimerOne Timer1;
+
+#endif
@@ -0,0 +1,4 @@
+// The RTC is simulated above the I2C layer, see MCP79412RTC.h.
+#ifndef Wire_h
+#define Wire_h
+#endif
@@ -0,0 +1,10 @@
+// Interrupt vectors become plain functions the simulator calls.
+#ifndef SIM_INTERRUPT_H
+#define SIM_INTERRUPT_H
+
+#define ISR(vector) extern "C" void vector(void); extern "C" void vector(void)
+
+void cli(void);
+void sei(void);
+
+#endif
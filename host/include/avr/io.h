@@ -0,0 +1,101 @@
+// Host stand-ins for the ATmega328p registers the firmware touches.
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+#define SIM_REG8(name)  extern volatile uint8_t  sim_##name;
+#define SIM_REG16(name) extern volatile uint16_t sim_##name;
+
+SIM_REG8(PORTB) SIM_REG8(PORTC) SIM_REG8(PORTD)
+SIM_REG8(PINB)  SIM_REG8(PINC)  SIM_REG8(PIND)
+SIM_REG8(DDRB)  SIM_REG8(DDRC)  SIM_REG8(DDRD)
+SIM_REG8(PCICR) SIM_REG8(PCIFR) SIM_REG8(PCMSK0) SIM_REG8(PCMSK1) SIM_REG8(PCMSK2)
+SIM_REG8(SREG)  SIM_REG8(SMCR)
+SIM_REG8(SPCR)  SIM_REG8(SPSR)  SIM_REG8(SPDR)
+SIM_REG8(UCSR0A) SIM_REG8(UCSR0B) SIM_REG8(UCSR0C) SIM_REG8(UDR0)
+SIM_REG8(TCCR1A) SIM_REG8(TCCR1B) SIM_REG8(TIMSK1)
+SIM_REG16(UBRR0) SIM_REG16(ICR1)
+
+#define PORTB  sim_PORTB
+#define PORTC  sim_PORTC
+#define PORTD  sim_PORTD
+#define PINB   sim_PINB
+#define PINC   sim_PINC
+#define PIND   sim_PIND
+#define DDRB   sim_DDRB
+#define DDRC   sim_DDRC
+#define DDRD   sim_DDRD
+#define PCICR  sim_PCICR
+#define PCIFR  sim_PCIFR
+#define PCMSK0 sim_PCMSK0
+#define PCMSK1 sim_PCMSK1
+#define PCMSK2 sim_PCMSK2
+#define SREG   sim_SREG
+#define SMCR   sim_SMCR
+#define SPCR   sim_SPCR
+#define SPSR   sim_SPSR
+#define SPDR   sim_SPDR
+#define UCSR0A sim_UCSR0A
+#define UCSR0B sim_UCSR0B
+#define UCSR0C sim_UCSR0C
+#define UDR0   sim_UDR0
+#define UBRR0  sim_UBRR0
+#define TCCR1A sim_TCCR1A
+#define TCCR1B sim_TCCR1B
+#define TIMSK1 sim_TIMSK1
+#define ICR1   sim_ICR1
+
+// TCNT1 reads back the host time spent since the running Timer1
+// interrupt was dispatched, in Timer1 counts, so ISR cost measurements
+// taken from it work in the simulator too.
+struct SimTimerCounter
+{
+	operator uint16_t() const;
+	SimTimerCounter &operator=(uint16_t value);
+};
+extern SimTimerCounter sim_TCNT1;
+#define TCNT1 sim_TCNT1
+
+// bit positions
+#define PCIE0   0
+#define PCIE1   1
+#define PCIE2   2
+#define PCINT8  0
+#define PCINT9  1
+#define PCINT10 2
+#define PCINT11 3
+#define SPR0    0
+#define SPR1    1
+#define CPHA    2
+#define CPOL    3
+#define MSTR    4
+#define DORD    5
+#define SPE     6
+#define SPIE    7
+#define SPI2X   0
+#define SPIF    7
+#define UCPOL0  0
+#define UCPHA0  1
+#define UDORD0  2
+#define UMSEL00 6
+#define UMSEL01 7
+#define TXEN0   3
+#define TXCIE0  6
+#define UDRE0   5
+#define TXC0    6
+#define CS10    0
+#define CS11    1
+#define CS12    2
+#define WGM13   4
+#define TOIE1   0
+
+// ATmega328p SPI pins
+#define SS   10
+#define MOSI 11
+#define MISO 12
+#define SCK  13
+
+#endif
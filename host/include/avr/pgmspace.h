@@ -0,0 +1,42 @@
+// Program memory is ordinary memory on the host.
+#ifndef SIM_PGMSPACE_H
+#define SIM_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+// Wider reads copy the bytes, like the chip: any alignment, any type
+// behind the address, and the host is little-endian too.
+static inline uint16_t sim_pgm_read_word(const void *addr)
+{
+	uint16_t value;
+	memcpy(&value, addr, sizeof(value));
+	return value;
+}
+
+static inline uint32_t sim_pgm_read_dword(const void *addr)
+{
+	uint32_t value;
+	memcpy(&value, addr, sizeof(value));
+	return value;
+}
+
+static inline void *sim_pgm_read_ptr(const void *addr)
+{
+	void *value;
+	memcpy(&value, addr, sizeof(value));
+	return value;
+}
+
+#define pgm_read_byte(addr)  (*(const uint8_t *) (addr))
+#define pgm_read_word(addr)  sim_pgm_read_word(addr)
+#define pgm_read_dword(addr) sim_pgm_read_dword(addr)
+#define pgm_read_ptr(addr)   sim_pgm_read_ptr(addr)
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+#endif
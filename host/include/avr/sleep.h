@@ -0,0 +1,20 @@
+// sleep_cpu() advances virtual time to the next simulated interrupt.
+#ifndef SIM_SLEEP_H
+#define SIM_SLEEP_H
+
+#include <stdint.h>
+
+#define SLEEP_MODE_IDLE      0
+#define SLEEP_MODE_ADC       1
+#define SLEEP_MODE_PWR_DOWN  2
+#define SLEEP_MODE_PWR_SAVE  3
+#define SLEEP_MODE_STANDBY   6
+#define SLEEP_MODE_EXT_STANDBY 7
+
+void set_sleep_mode(uint8_t mode);
+void sleep_enable(void);
+void sleep_disable(void);
+void sleep_cpu(void);
+void sleep_mode(void);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef SIM_ATOMIC_H
+#define SIM_ATOMIC_H
+
+#include <avr/interrupt.h>
+
+static inline uint8_t sim_atomic_enter(void) { cli(); return 1; }
+static inline void sim_atomic_leave(const uint8_t *) { sei(); }
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define ATOMIC_BLOCK(type) \
+	for (uint8_t sim_atomic __attribute__((__cleanup__(sim_atomic_leave))) = sim_atomic_enter(); \
+		sim_atomic; sim_atomic = 0)
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef SIM_CRC16_H
+#define SIM_CRC16_H
+
+#include <stdint.h>
+
+// avr-libc's CRC-8, polynomial 0x07, one byte at a time
+static inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data)
+{
+	crc ^= data;
+	for (uint8_t i = 0; i < 8; i++)
+		crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+	return crc;
+}
+
+#endif
@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <deque>
+#include <string>
+
+#include <Arduino.h>
+
+#include "Simulator.h"
+#include "TelemetryDecoder.h"
+
+// ---------------------- //
+//  pins
+// ---------------------- //
+uint8_t digitalPinToPort(uint8_t pin)
+{
+	if (pin < 8)
+		return PD;
+	if (pin < 14)
+		return PB;
+	if (pin < 20)
+		return PC;
+	return NOT_A_PORT;
+}
+
+uint8_t digitalPinToBitMask(uint8_t pin)
+{
+	if (pin < 8)
+		return _BV(pin);
+	if (pin < 14)
+		return _BV(pin - 8);
+	return _BV((pin - 14) & 0x07);
+}
+
+volatile uint8_t *portOutputRegister(uint8_t port)
+{
+	switch (port)
+	{
+		case PB: return &PORTB;
+		case PC: return &PORTC;
+		case PD: return &PORTD;
+	}
+	return 0;
+}
+
+volatile uint8_t *portInputRegister(uint8_t port)
+{
+	switch (port)
+	{
+		case PB: return &PINB;
+		case PC: return &PINC;
+		case PD: return &PIND;
+	}
+	return 0;
+}
+
+volatile uint8_t *portModeRegister(uint8_t port)
+{
+	switch (port)
+	{
+		case PB: return &DDRB;
+		case PC: return &DDRC;
+		case PD: return &DDRD;
+	}
+	return 0;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	volatile uint8_t *ddr = portModeRegister(digitalPinToPort(pin));
+	volatile uint8_t *out = portOutputRegister(digitalPinToPort(pin));
+	uint8_t mask = digitalPinToBitMask(pin);
+	if (!ddr)
+		return;
+
+	if (mode == OUTPUT)
+	{
+		*ddr |= mask;
+	} else
+	{
+		*ddr &= ~mask;
+		if (mode == INPUT_PULLUP)
+			*out |= mask;
+		else
+			*out &= ~mask;
+	}
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	volatile uint8_t *out = portOutputRegister(digitalPinToPort(pin));
+	uint8_t mask = digitalPinToBitMask(pin);
+	if (!out)
+		return;
+
+	if (val == LOW)
+		*out &= ~mask;
+	else
+		*out |= mask;
+}
+
+int digitalRead(uint8_t pin)
+{
+	uint8_t port = digitalPinToPort(pin);
+	uint8_t mask = digitalPinToBitMask(pin);
+
+	// the port C inputs are driven by the simulator
+	if (port == PC && !(DDRC & mask))
+		return sim::input(pin - 14) ? HIGH : LOW;
+
+	return (*portOutputRegister(port) & mask) ? HIGH : LOW;
+}
+
+void analogWrite(uint8_t pin, int val)
+{
+	pinMode(pin, OUTPUT);
+	digitalWrite(pin, val < 128 ? LOW : HIGH);
+}
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
+{
+	for (uint8_t i = 0; i < 8; i++)
+	{
+		if (bitOrder == LSBFIRST)
+			digitalWrite(dataPin, !!(val & _BV(i)));
+		else
+			digitalWrite(dataPin, !!(val & _BV(7 - i)));
+
+		digitalWrite(clockPin, HIGH);
+		digitalWrite(clockPin, LOW);
+	}
+}
+
+// ---------------------- //
+//  time
+// ---------------------- //
+unsigned long micros(void)
+{
+	sim::advance(SIM_CALL_COST);
+	return (unsigned long) (sim::cycles / (F_CPU / 1000000L));
+}
+
+unsigned long millis(void)
+{
+	sim::advance(SIM_CALL_COST);
+	return (unsigned long) (sim::cycles / (F_CPU / 1000L));
+}
+
+void delay(unsigned long ms)
+{
+	sim::advance(sim::msToCycles(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	sim::advance(sim::usToCycles(us));
+}
+
+// ---------------------- //
+//  buzzer
+// ---------------------- //
+namespace sim
+{
+	unsigned long toneCount    = 0;
+	unsigned int toneFrequency = 0;
+}
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration)
+{
+	(void) duration;
+	pinMode(pin, OUTPUT);
+
+	if (sim::verbose)
+		sim::trace("tone %u Hz", frequency);
+
+	sim::toneCount++;
+	sim::toneFrequency = frequency;
+}
+
+void noTone(uint8_t pin)
+{
+	digitalWrite(pin, LOW);
+
+	if (sim::verbose && sim::toneFrequency)
+		sim::trace("tone off");
+
+	sim::toneFrequency = 0;
+}
+
+// ---------------------- //
+//  Print
+// ---------------------- //
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+	size_t n = 0;
+	while (size--)
+		n += write(*buffer++);
+	return n;
+}
+
+size_t Print::print(const char str[])   { return write(str); }
+size_t Print::print(char c)             { return write((uint8_t) c); }
+size_t Print::print(unsigned char n, int base) { return print((unsigned long) n, base); }
+size_t Print::print(unsigned int n, int base)  { return print((unsigned long) n, base); }
+size_t Print::print(int n, int base)           { return print((long) n, base); }
+
+size_t Print::print(long n, int base)
+{
+	if (base == 10 && n < 0)
+		return print('-') + printNumber(-n, 10);
+	return printNumber(n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+	return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+	return write(buffer);
+}
+
+size_t Print::println(void)
+{
+	return write("\r\n");
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base)
+{
+	char buffer[8 * sizeof(long) + 1];
+	char *str = &buffer[sizeof(buffer) - 1];
+	*str = '\0';
+
+	if (base < 2)
+		base = 10;
+
+	do
+	{
+		char c = n % base;
+		n /= base;
+		*--str = c < 10 ? c + '0' : c + 'A' - 10;
+	} while (n);
+
+	return write(str);
+}
+
+// ---------------------- //
+//  Serial
+// ---------------------- //
+// TX drains at the baud rate through the core's 64 byte buffer, RX
+// bytes come from the script. Output lines go to stdout, stamped with
+// the virtual time.
+#define SERIAL_BUFFER_SIZE 64
+
+HardwareSerial Serial;
+
+namespace sim
+{
+	unsigned long serialBytesOut = 0;
+
+	static unsigned long serialBaud  = 0;
+	static uint64_t      txIdleAt    = 0; // cycle the TX buffer empties
+	static char          rxBuffer[256];
+	static uint8_t       rxHead      = 0;
+	static uint8_t       rxTail      = 0;
+	static TelemetryDecoder decoder;
+
+	static uint64_t byteCycles()
+	{
+		// start, 8 data and stop bits
+		return serialBaud ? 10ULL * F_CPU / serialBaud : 0;
+	}
+
+	void serialInject(const char *text)
+	{
+		while (*text)
+		{
+			uint8_t next = rxHead + 1;
+			if (next == rxTail)
+				break;
+			rxBuffer[rxHead] = *text++;
+			rxHead = next;
+		}
+		raise(SIM_IRQ_USART_RX);
+	}
+
+	static void serialEmit(uint8_t c)
+	{
+		std::string line;
+		bool record;
+
+		decoder.feed(c);
+		while (decoder.next(line, record))
+			trace("%s", line.c_str());
+	}
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+	sim::serialBaud = baud;
+	sim::txIdleAt   = sim::cycles;
+}
+
+int HardwareSerial::available(void)
+{
+	return (uint8_t) (sim::rxHead - sim::rxTail);
+}
+
+int HardwareSerial::peek(void)
+{
+	if (sim::rxHead == sim::rxTail)
+		return -1;
+	return (uint8_t) sim::rxBuffer[sim::rxTail];
+}
+
+int HardwareSerial::read(void)
+{
+	int c = peek();
+	if (c >= 0)
+		sim::rxTail++;
+	return c;
+}
+
+int HardwareSerial::availableForWrite(void)
+{
+	uint64_t perByte = sim::byteCycles();
+	if (!perByte || sim::txIdleAt <= sim::cycles)
+		return SERIAL_BUFFER_SIZE - 1;
+
+	uint64_t queued = (sim::txIdleAt - sim::cycles + perByte - 1) / perByte;
+	return queued >= SERIAL_BUFFER_SIZE - 1 ? 0 : SERIAL_BUFFER_SIZE - 1 - queued;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+	// a full buffer blocks until the oldest byte has gone out
+	if (!availableForWrite())
+		sim::advance(sim::txIdleAt - sim::cycles
+			- (SERIAL_BUFFER_SIZE - 2) * sim::byteCycles());
+
+	sim::txIdleAt = max(sim::txIdleAt, sim::cycles) + sim::byteCycles();
+	sim::serialBytesOut++;
+	sim::serialEmit(c);
+	return 1;
+}
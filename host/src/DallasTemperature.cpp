@@ -0,0 +1,210 @@
+#include <DallasTemperature.h>
+
+#include "Simulator.h"
+
+// ---------------------- //
+//  ambient model
+// ---------------------- //
+// The room temperature ramps linearly to the last target the script
+// set, in 1/128 C like the library's raw readings.
+namespace sim
+{
+	static int16_t  ambientFrom   = 21 * 128;
+	static int16_t  ambientTo     = 21 * 128;
+	static uint64_t rampStart     = 0;
+	static uint64_t rampCycles    = 0;
+
+	int16_t ambient()
+	{
+		if (!rampCycles || cycles >= rampStart + rampCycles)
+			return ambientTo;
+
+		double done = (double) (cycles - rampStart) / rampCycles;
+		return ambientFrom + (int16_t) ((ambientTo - ambientFrom) * done);
+	}
+
+	void setAmbient(int16_t target, uint64_t ramp)
+	{
+		ambientFrom = ambient();
+		ambientTo   = target;
+		rampStart   = cycles;
+		rampCycles  = ramp;
+	}
+}
+
+// ---------------------- //
+//  1-Wire bus
+// ---------------------- //
+// OneWire keeps interrupts off through each bit slot: up to 65 us to
+// write a zero, 13 us to sample a read. Only the timing is modelled,
+// the worst case of every written bit.
+namespace sim
+{
+	static void busReset()
+	{
+		advance(usToCycles(960));
+	}
+
+	static void busSlots(unsigned writes, unsigned reads)
+	{
+		while (writes--)
+		{
+			cli();
+			advance(usToCycles(65));
+			sei();
+			advance(usToCycles(5));
+		}
+
+		while (reads--)
+		{
+			cli();
+			advance(usToCycles(13));
+			sei();
+			advance(usToCycles(53));
+		}
+	}
+}
+
+// ---------------------- //
+//  DS18B20
+// ---------------------- //
+static const DeviceAddress sensorAddress = {0x28, 0x53, 0x49, 0x4D, 0x00, 0x00, 0x00, 0x5C};
+
+DallasTemperature::DallasTemperature(OneWire *wire)
+{
+	(void) wire;
+	_waitForConversion  = true;
+	_autoSaveScratchPad = true;
+	_resolution        = 12;
+	_conversionStart   = 0;
+	_scratchpad        = 85 * 128; // power-on value
+	_converting        = false;
+}
+
+void DallasTemperature::begin(void)
+{
+}
+
+uint8_t DallasTemperature::getDeviceCount(void)
+{
+	return 1;
+}
+
+bool DallasTemperature::getAddress(uint8_t *deviceAddress, uint8_t index)
+{
+	if (index)
+		return false;
+
+	memcpy(deviceAddress, sensorAddress, sizeof(DeviceAddress));
+	return true;
+}
+
+uint8_t DallasTemperature::getResolution()
+{
+	return _resolution;
+}
+
+uint8_t DallasTemperature::getResolution(const uint8_t *deviceAddress)
+{
+	(void) deviceAddress;
+	return _resolution;
+}
+
+void DallasTemperature::setResolution(uint8_t newResolution)
+{
+	_resolution = constrain(newResolution, 9, 12);
+}
+
+bool DallasTemperature::setResolution(const uint8_t *deviceAddress, uint8_t newResolution, bool skipGlobalBitResolutionCalculation)
+{
+	(void) deviceAddress;
+	(void) skipGlobalBitResolutionCalculation;
+
+	// match ROM, read scratchpad
+	sim::busReset();
+	sim::busSlots(8 + 64 + 8, 72);
+	if (constrain(newResolution, 9, 12) == _resolution)
+		return true;
+
+	// match ROM, write TH, TL and the configuration register
+	sim::busReset();
+	sim::busSlots(8 + 64 + 8 + 24, 0);
+	setResolution(newResolution);
+
+	// match ROM, copy scratchpad, then the library waits out the
+	// sensor's EEPROM write
+	if (_autoSaveScratchPad)
+	{
+		sim::busReset();
+		sim::busSlots(8 + 64 + 8, 0);
+		delay(20);
+	}
+	return true;
+}
+
+int16_t DallasTemperature::millisToWaitForConversion(uint8_t bitResolution)
+{
+	switch (bitResolution)
+	{
+		case 9:  return 94;
+		case 10: return 188;
+		case 11: return 375;
+		default: return 750;
+	}
+}
+
+void DallasTemperature::requestTemperatures(void)
+{
+	// skip ROM, convert T
+	sim::busReset();
+	sim::busSlots(16, 0);
+
+	_conversionStart = millis();
+	_converting = true;
+
+	if (_waitForConversion)
+		delay(millisToWaitForConversion(_resolution));
+}
+
+bool DallasTemperature::requestTemperaturesByAddress(const uint8_t *deviceAddress)
+{
+	(void) deviceAddress;
+	requestTemperatures();
+	return true;
+}
+
+bool DallasTemperature::isConversionComplete(void)
+{
+	if (_converting && millis() - _conversionStart >= (unsigned long) millisToWaitForConversion(_resolution))
+	{
+		// the sensor only keeps the bits its resolution converts
+		int16_t raw = sim::ambient() >> 3; // 1/16 C
+		raw &= ~((1 << (12 - _resolution)) - 1);
+		_scratchpad = raw << 3;
+		_converting = false;
+	}
+
+	return !_converting;
+}
+
+int16_t DallasTemperature::getTemp(const uint8_t *deviceAddress)
+{
+	(void) deviceAddress;
+
+	// match ROM, read scratchpad, all nine bytes of it
+	sim::busReset();
+	sim::busSlots(8 + 64 + 8, 72);
+
+	isConversionComplete();
+	return _scratchpad;
+}
+
+float DallasTemperature::getTempC(const uint8_t *deviceAddress)
+{
+	return getTemp(deviceAddress) * 0.0078125f;
+}
+
+float DallasTemperature::getTempCByIndex(uint8_t index)
+{
+	return index ? DEVICE_DISCONNECTED_C : getTempC(sensorAddress);
+}
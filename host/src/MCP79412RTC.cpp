@@ -0,0 +1,306 @@
+#include <stdio.h>
+
+#include <MCP79412RTC.h>
+
+#include "Simulator.h"
+
+MCP79412RTC RTC;
+
+// ---------------------- //
+//  RTC model
+// ---------------------- //
+// The oscillator runs on the simulated clock. Writing the time resets
+// the divider chain, so the seconds and the 1 Hz square wave always
+// roll over together: MFP falls on the second and rises half-way.
+namespace sim
+{
+	uint64_t rtcNext = SIM_NEVER;
+	bool     rtcTimeFails = false;
+	unsigned long eepromWrites = 0;
+
+	static uint32_t rtcBase      = 0;
+	static uint64_t rtcBaseCycle = 0;
+	static bool     sqwEnabled   = false;
+	static bool     outLevel     = true;
+	static bool     alarmPol     = false;
+	static bool     mfpLevel     = true;
+
+	static tmElements_t alarmTime[2];
+	static uint8_t      alarmType[2]  = {ALM_DISABLE, ALM_DISABLE};
+	static bool         alarmFlag[2]  = {false, false};
+
+	static byte sram[SRAM_SIZE];
+	static byte eeprom[EEPROM_SIZE];
+	static int  calibration = 0;
+
+	static uint32_t rtcSeconds()
+	{
+		return rtcBase + (cycles - rtcBaseCycle) / F_CPU;
+	}
+
+	static bool alarmMatches(uint8_t n, const tmElements_t &tm)
+	{
+		const tmElements_t &a = alarmTime[n];
+
+		switch (alarmType[n])
+		{
+			case ALM_MATCH_SECONDS:  return tm.Second == a.Second;
+			case ALM_MATCH_MINUTES:  return tm.Minute == a.Minute;
+			case ALM_MATCH_HOURS:    return tm.Hour == a.Hour;
+			case ALM_MATCH_DAY:      return tm.Wday == a.Wday;
+			case ALM_MATCH_DATE:     return tm.Day == a.Day;
+			case ALM_MATCH_DATETIME:
+				return tm.Second == a.Second && tm.Minute == a.Minute
+					&& tm.Hour == a.Hour && tm.Wday == a.Wday
+					&& tm.Day == a.Day && tm.Month == a.Month;
+		}
+		return false;
+	}
+
+	void rtcUpdateMfp()
+	{
+		bool level;
+
+		if (rtcTimeFails)
+			level = true; // the pull-up
+		else if (sqwEnabled)
+			level = ((cycles - rtcBaseCycle) % F_CPU) >= F_CPU / 2;
+		else if (alarmType[0] != ALM_DISABLE || alarmType[1] != ALM_DISABLE)
+			level = (alarmFlag[0] || alarmFlag[1]) ? alarmPol : !alarmPol;
+		else
+			level = outLevel;
+
+		if (level != mfpLevel)
+		{
+			mfpLevel = level;
+			if (verbose)
+				trace("rtc mfp %s", level ? "high" : "low");
+		}
+
+		setInput(SIM_MFP, mfpLevel);
+	}
+
+	static void rtcSchedule()
+	{
+		uint64_t half = F_CPU / 2;
+		rtcNext = rtcBaseCycle + ((cycles - rtcBaseCycle) / half + 1) * half;
+	}
+
+	void rtcTick()
+	{
+		if (!((cycles - rtcBaseCycle) % F_CPU))
+		{
+			tmElements_t tm;
+			breakTime(rtcSeconds(), tm);
+
+			for (uint8_t n = 0; n < 2; n++)
+			{
+				if (alarmType[n] != ALM_DISABLE && alarmMatches(n, tm))
+				{
+					alarmFlag[n] = true;
+					if (verbose)
+						trace("rtc alarm %u match", n);
+				}
+			}
+		}
+
+		rtcUpdateMfp();
+		rtcSchedule();
+	}
+
+	void rtcBegin(uint32_t t)
+	{
+		rtcBase      = t;
+		rtcBaseCycle = cycles;
+		memset(eeprom, 0xFF, sizeof(eeprom));
+		rtcSchedule();
+		rtcUpdateMfp();
+	}
+
+	// a missing file is a chip that never had power: blank SRAM, erased EEPROM
+	bool rtcLoadMemory(const char *path)
+	{
+		FILE *f = fopen(path, "rb");
+		if (!f)
+			return true;
+
+		bool ok = fread(sram, sizeof(sram), 1, f) == 1 && fread(eeprom, sizeof(eeprom), 1, f) == 1;
+		fclose(f);
+		if (!ok)
+			fprintf(stderr, "%s: not an RTC memory file\n", path);
+		return ok;
+	}
+
+	bool rtcSaveMemory(const char *path)
+	{
+		FILE *f = fopen(path, "wb");
+		bool ok = f && fwrite(sram, sizeof(sram), 1, f) == 1 && fwrite(eeprom, sizeof(eeprom), 1, f) == 1;
+		if (f && fclose(f))
+			ok = false;
+		if (!ok)
+			perror(path);
+		return ok;
+	}
+}
+
+// ---------------------- //
+//  library API
+// ---------------------- //
+MCP79412RTC::MCP79412RTC()
+{
+}
+
+time_t MCP79412RTC::get(void)
+{
+	// the library reads 0 when the chip does not answer
+	return sim::rtcTimeFails ? 0 : sim::rtcSeconds();
+}
+
+void MCP79412RTC::set(time_t t)
+{
+	sim::rtcBase      = t;
+	sim::rtcBaseCycle = sim::cycles;
+	sim::rtcSchedule();
+	sim::rtcUpdateMfp();
+}
+
+bool MCP79412RTC::read(tmElements_t &tm)
+{
+	breakTime(get(), tm);
+	return !sim::rtcTimeFails;
+}
+
+void MCP79412RTC::write(tmElements_t &tm)
+{
+	set(makeTime(tm));
+}
+
+void MCP79412RTC::sramWrite(byte addr, byte value)
+{
+	sramWrite(addr, &value, 1);
+}
+
+void MCP79412RTC::sramWrite(byte addr, byte *values, byte nBytes)
+{
+	for (byte i = 0; i < nBytes; i++)
+		sim::sram[(addr + i) % SRAM_SIZE] = values[i];
+}
+
+byte MCP79412RTC::sramRead(byte addr)
+{
+	byte value;
+	sramRead(addr, &value, 1);
+	return value;
+}
+
+void MCP79412RTC::sramRead(byte addr, byte *values, byte nBytes)
+{
+	for (byte i = 0; i < nBytes; i++)
+		values[i] = sim::sram[(addr + i) % SRAM_SIZE];
+}
+
+void MCP79412RTC::eepromWrite(byte addr, byte value)
+{
+	eepromWrite(addr, &value, 1);
+}
+
+// like the chip, a write wraps around inside its 8 byte page
+void MCP79412RTC::eepromWrite(byte addr, byte *values, byte nBytes)
+{
+	byte page = addr & ~(EEPROM_PAGE_SIZE - 1);
+
+	for (byte i = 0; i < nBytes && i < EEPROM_PAGE_SIZE; i++)
+		sim::eeprom[(page + ((addr + i) & (EEPROM_PAGE_SIZE - 1))) % EEPROM_SIZE] = values[i];
+
+	sim::eepromWrites++;
+	sim::trace("rtc: eeprom page 0x%02x written", page);
+
+	// the library polls for the end of the write cycle
+	delay(EEPROM_WRITE);
+}
+
+byte MCP79412RTC::eepromRead(byte addr)
+{
+	byte value;
+	eepromRead(addr, &value, 1);
+	return value;
+}
+
+void MCP79412RTC::eepromRead(byte addr, byte *values, byte nBytes)
+{
+	for (byte i = 0; i < nBytes; i++)
+		values[i] = sim::eeprom[(addr + i) % EEPROM_SIZE];
+}
+
+int MCP79412RTC::calibRead(void)
+{
+	return sim::calibration;
+}
+
+void MCP79412RTC::calibWrite(int value)
+{
+	sim::calibration = value;
+}
+
+void MCP79412RTC::idRead(byte *uniqueID)
+{
+	static const byte id[8] = {0x00, 0x04, 0xA3, 0xFF, 0xFE, 0x12, 0x34, 0x56};
+	memcpy(uniqueID, id, sizeof(id));
+}
+
+void MCP79412RTC::setAlarm(uint8_t alarmNumber, time_t alarmTime)
+{
+	breakTime(alarmTime, sim::alarmTime[alarmNumber & 1]);
+}
+
+// writing the alarm type also clears the interrupt flag
+void MCP79412RTC::enableAlarm(uint8_t alarmNumber, uint8_t alarmType)
+{
+	alarmNumber &= 1;
+	sim::alarmType[alarmNumber] = alarmType < ALM_DISABLE ? alarmType : ALM_DISABLE;
+	sim::alarmFlag[alarmNumber] = false;
+	sim::rtcUpdateMfp();
+}
+
+bool MCP79412RTC::alarm(uint8_t alarmNumber)
+{
+	alarmNumber &= 1;
+	bool flag = sim::alarmFlag[alarmNumber];
+
+	if (flag)
+	{
+		sim::alarmFlag[alarmNumber] = false;
+		sim::rtcUpdateMfp();
+	}
+
+	return flag;
+}
+
+void MCP79412RTC::out(bool level)
+{
+	sim::outLevel = level;
+	sim::rtcUpdateMfp();
+}
+
+void MCP79412RTC::alarmPolarity(bool polarity)
+{
+	sim::alarmPol = polarity;
+	sim::rtcUpdateMfp();
+}
+
+bool MCP79412RTC::isRunning(void)
+{
+	return true;
+}
+
+void MCP79412RTC::vbaten(bool enable)
+{
+	(void) enable;
+}
+
+void MCP79412RTC::squareWave(uint8_t freq)
+{
+	// only the 1 Hz output is modelled, the faster ones just enable it
+	sim::sqwEnabled = freq != SQWAVE_NONE;
+	sim::rtcUpdateMfp();
+}
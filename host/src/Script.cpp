@@ -0,0 +1,255 @@
+// Stimulus script: one event per line, "<time> <command> [args]".
+// Times are from the start of the run ("90s", "1d6h30m", "250ms") or,
+// with a leading '+', from the previous line. Commands:
+//   press A|B [duration]  hold a button, 100ms by default
+//   click A|B             short press
+//   double A|B            two short presses
+//   long A|B              1s press
+//   temp <C> [ramp]       move the room temperature, optionally linearly
+//   serial <text>         send a line to the firmware
+//   rtc <seconds>         shift the RTC by a signed number of seconds
+//   end                   stop the run
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <MCP79412RTC.h>
+
+#include "Simulator.h"
+
+#define CLICK_DURATION  100 // ms
+#define LONG_DURATION  1000 // ms
+
+namespace sim
+{
+	uint64_t scriptNext = SIM_NEVER;
+
+	enum EventKind { PIN_DOWN, PIN_UP, TEMP, SERIAL_LINE, RTC_SHIFT, END };
+
+	struct Event
+	{
+		uint64_t    at;
+		EventKind   kind;
+		long        value;
+		uint64_t    span;
+		std::string text;
+
+		bool operator<(const Event &other) const { return at < other.at; }
+	};
+
+	static std::vector<Event> events;
+	static size_t nextEvent = 0;
+
+	bool parseDuration(const char *text, uint64_t &us)
+	{
+		uint64_t total = 0;
+		bool any = false;
+
+		while (*text)
+		{
+			char *end;
+			double value = strtod(text, &end);
+			if (end == text)
+				return false;
+			text = end;
+
+			uint64_t unit = 1000000;
+			if (!strncmp(text, "ms", 2))      { unit = 1000;          text += 2; }
+			else if (!strncmp(text, "us", 2)) { unit = 1;             text += 2; }
+			else if (*text == 's')            { unit = 1000000;       text++; }
+			else if (*text == 'm')            { unit = 60000000;      text++; }
+			else if (*text == 'h')            { unit = 3600000000ULL; text++; }
+			else if (*text == 'd')            { unit = 86400000000ULL; text++; }
+			else if (*text)                   return false;
+
+			total += (uint64_t) (value * unit);
+			any = true;
+		}
+
+		us = total;
+		return any;
+	}
+
+	static void addPress(uint64_t at, uint8_t bit, uint64_t duration)
+	{
+		Event down = {at, PIN_DOWN, bit, 0, ""};
+		Event up   = {at + duration, PIN_UP, bit, 0, ""};
+		events.push_back(down);
+		events.push_back(up);
+	}
+
+	static bool parseButton(const char *name, uint8_t &bit)
+	{
+		if (!name)
+			return false;
+		if (toupper(*name) == 'A')
+			bit = SIM_BUTTON_A;
+		else if (toupper(*name) == 'B')
+			bit = SIM_BUTTON_B;
+		else
+			return false;
+		return true;
+	}
+
+	static bool parseLine(char *line, uint64_t &last)
+	{
+		char *hash = strchr(line, '#');
+		if (hash)
+			*hash = '\0';
+
+		char *rest = 0;
+		char *when = strtok_r(line, " \t\r\n", &rest);
+		if (!when)
+			return true;
+
+		uint64_t us;
+		bool relative = *when == '+';
+		if (!parseDuration(when + relative, us))
+			return false;
+
+		uint64_t at = usToCycles(us) + (relative ? last : 0);
+		last = at;
+
+		char *command = strtok_r(0, " \t\r\n", &rest);
+		if (!command)
+			return false;
+
+		char *arg = strtok_r(0, " \t\r\n", &rest);
+		uint8_t bit;
+
+		if (!strcmp(command, "press") && parseButton(arg, bit))
+		{
+			char *length = strtok_r(0, " \t\r\n", &rest);
+			uint64_t duration = CLICK_DURATION * 1000ULL;
+			if (length && !parseDuration(length, duration))
+				return false;
+			addPress(at, bit, usToCycles(duration));
+
+		} else if (!strcmp(command, "click") && parseButton(arg, bit))
+		{
+			addPress(at, bit, msToCycles(CLICK_DURATION));
+
+		} else if (!strcmp(command, "double") && parseButton(arg, bit))
+		{
+			addPress(at, bit, msToCycles(CLICK_DURATION));
+			addPress(at + msToCycles(2 * CLICK_DURATION), bit, msToCycles(CLICK_DURATION));
+
+		} else if (!strcmp(command, "long") && parseButton(arg, bit))
+		{
+			addPress(at, bit, msToCycles(LONG_DURATION));
+
+		} else if (!strcmp(command, "temp") && arg)
+		{
+			char *ramp = strtok_r(0, " \t\r\n", &rest);
+			uint64_t duration = 0;
+			if (ramp && !parseDuration(ramp, duration))
+				return false;
+			Event e = {at, TEMP, (long) (atof(arg) * 128), usToCycles(duration), ""};
+			events.push_back(e);
+
+		} else if (!strcmp(command, "serial") && arg)
+		{
+			std::string text(arg);
+			if (*rest)
+				text += std::string(" ") + rest;
+			while (!text.empty() && isspace(text[text.size() - 1]))
+				text.erase(text.size() - 1);
+			Event e = {at, SERIAL_LINE, 0, 0, text + "\n"};
+			events.push_back(e);
+
+		} else if (!strcmp(command, "rtc") && arg)
+		{
+			Event e = {at, RTC_SHIFT, atol(arg), 0, ""};
+			events.push_back(e);
+
+		} else if (!strcmp(command, "end"))
+		{
+			Event e = {at, END, 0, 0, ""};
+			events.push_back(e);
+
+		} else
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	bool scriptLoad(const char *path)
+	{
+		FILE *file = fopen(path, "r");
+		if (!file)
+		{
+			perror(path);
+			return false;
+		}
+
+		char line[256];
+		unsigned number = 0;
+		uint64_t last = 0;
+
+		while (fgets(line, sizeof(line), file))
+		{
+			number++;
+			if (!parseLine(line, last))
+			{
+				fprintf(stderr, "%s:%u: cannot parse line\n", path, number);
+				fclose(file);
+				return false;
+			}
+		}
+
+		fclose(file);
+		std::stable_sort(events.begin(), events.end());
+		nextEvent  = 0;
+		scriptNext = events.empty() ? SIM_NEVER : events[0].at;
+		return true;
+	}
+
+	void scriptFire()
+	{
+		while (nextEvent < events.size() && events[nextEvent].at <= cycles)
+		{
+			const Event &e = events[nextEvent++];
+
+			switch (e.kind)
+			{
+				case PIN_DOWN:
+				case PIN_UP:
+					if (verbose || e.kind == PIN_DOWN)
+						trace("script: button %c %s", e.value == SIM_BUTTON_A ? 'A' : 'B',
+							e.kind == PIN_DOWN ? "down" : "up");
+					// buttons are active low
+					setInput(e.value, e.kind == PIN_UP);
+					break;
+
+				case TEMP:
+					trace("script: temperature %.2f C", e.value / 128.0);
+					setAmbient(e.value, e.span);
+					break;
+
+				case SERIAL_LINE:
+					trace("script: serial \"%.*s\"", (int) e.text.size() - 1, e.text.c_str());
+					serialInject(e.text.c_str());
+					break;
+
+				case RTC_SHIFT:
+					trace("script: rtc %+ld s", e.value);
+					RTC.set(RTC.get() + e.value);
+					break;
+
+				case END:
+					trace("script: end");
+					endCycles = cycles;
+					break;
+			}
+		}
+
+		scriptNext = nextEvent < events.size() ? events[nextEvent].at : SIM_NEVER;
+	}
+}
@@ -0,0 +1,385 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+
+#include "Simulator.h"
+
+// firmware vectors, only the ones the sketch defines are linked in
+extern "C" void PCINT0_vect(void) __attribute__((weak));
+extern "C" void PCINT1_vect(void) __attribute__((weak));
+extern "C" void PCINT2_vect(void) __attribute__((weak));
+
+// ---------------------- //
+//  registers
+// ---------------------- //
+volatile uint8_t sim_PORTB, sim_PORTC, sim_PORTD;
+volatile uint8_t sim_PINB, sim_PINC = 0xFF, sim_PIND;
+volatile uint8_t sim_DDRB, sim_DDRC, sim_DDRD;
+volatile uint8_t sim_PCICR, sim_PCIFR, sim_PCMSK0, sim_PCMSK1, sim_PCMSK2;
+volatile uint8_t sim_SREG, sim_SMCR;
+volatile uint8_t sim_SPCR, sim_SPSR, sim_SPDR;
+volatile uint8_t sim_UCSR0A, sim_UCSR0B, sim_UCSR0C, sim_UDR0;
+volatile uint8_t sim_TCCR1A, sim_TCCR1B, sim_TIMSK1;
+volatile uint16_t sim_UBRR0, sim_ICR1;
+SimTimerCounter sim_TCNT1;
+
+namespace sim
+{
+	uint64_t cycles     = 0;
+	uint64_t endCycles  = SIM_NEVER;
+	uint64_t wakeCycles = 0;
+	double   hostScale  = 0.0;
+
+	bool    interruptsEnabled = false;
+	uint8_t pendingIrq        = 0;
+
+	void (*timer1Isr)()         = 0;
+	uint64_t timer1Next         = SIM_NEVER;
+	uint64_t timer1DispatchHost = 0;
+	bool     timer1InIsr        = false;
+	unsigned long timer1Count   = 0;
+	unsigned long timer1Missed  = 0;
+
+	bool quiet   = false;
+	bool verbose = false;
+
+	static uint64_t timer1Last = 0;
+	static uint16_t timer1Top  = 1; // where the running count turns back down
+	static uint64_t sleepFloor = 0; // Timer0 and Timer1 don't wake before this
+	static uint8_t  inputs     = 0xFF; // port C pins, pulled up
+
+	uint64_t usToCycles(uint64_t us) { return us * (F_CPU / 1000000L); }
+	uint64_t msToCycles(uint64_t ms) { return ms * (F_CPU / 1000L); }
+
+	uint64_t hostNanos()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+
+	// ---------------------- //
+	//  Timer1
+	// ---------------------- //
+	uint16_t timer1Prescale()
+	{
+		static const uint16_t prescale[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+		return prescale[TCCR1B & 0x07];
+	}
+
+	// phase correct: up to TOP and back down, one overflow per round trip
+	static uint64_t timer1Period()
+	{
+		return 2ULL * timer1Top * timer1Prescale();
+	}
+
+	static void timer1Bottom()
+	{
+		timer1Last = cycles;
+		timer1Top  = ICR1 ? ICR1 : 1;
+		timer1Next = timer1Prescale() ? cycles + timer1Period() : SIM_NEVER;
+	}
+
+	void timer1Restart()
+	{
+		timer1Bottom();
+	}
+
+	void timer1Retop()
+	{
+		if (!timer1Prescale())
+		{
+			timer1Next = SIM_NEVER;
+			return;
+		}
+
+		// ICR1 is not double-buffered: while counting up the counter
+		// turns at the new TOP, unless it is already past it. Then it
+		// runs on to MAX and back, and the next overflow comes up to
+		// 16 ms late at /1. Once counting down, the new TOP only
+		// matters for the next period.
+		uint64_t count = (cycles - timer1Last) / timer1Prescale();
+		if (count < timer1Top)
+		{
+			uint16_t top = ICR1 ? ICR1 : 1;
+			if (count <= top)
+			{
+				timer1Top = top;
+			} else
+			{
+				timer1Top = 0xFFFF;
+				timer1Missed++;
+			}
+		}
+
+		timer1Next = max(timer1Last + timer1Period(), cycles + 1);
+	}
+
+	static void timer1Overflow()
+	{
+		timer1Bottom();
+		if (TIMSK1 & _BV(TOIE1))
+			raise(SIM_IRQ_TIMER1_OVF);
+	}
+
+	// ---------------------- //
+	//  interrupts
+	// ---------------------- //
+	void raise(uint8_t irq)
+	{
+		pendingIrq |= irq;
+	}
+
+	static void dispatch(uint8_t irq)
+	{
+		switch (irq)
+		{
+			case SIM_IRQ_PCINT0:
+				if (PCINT0_vect) PCINT0_vect();
+				break;
+
+			case SIM_IRQ_PCINT1:
+				if (PCINT1_vect) PCINT1_vect();
+				break;
+
+			case SIM_IRQ_PCINT2:
+				if (PCINT2_vect) PCINT2_vect();
+				break;
+
+			case SIM_IRQ_TIMER1_OVF:
+				timer1Count++;
+				if (timer1Isr)
+				{
+					timer1InIsr        = true;
+					timer1DispatchHost = hostScale > 0 ? hostNanos() : 0;
+					timer1Isr();
+					timer1InIsr        = false;
+				}
+				// a new TOP written in the ISR sets the length of this period
+				timer1Retop();
+				break;
+
+			default:
+				// Timer0 and USART RX are handled by the core
+				break;
+		}
+	}
+
+	uint8_t service()
+	{
+		uint8_t served = 0;
+
+		while (interruptsEnabled && pendingIrq)
+		{
+			uint8_t irq = pendingIrq & -pendingIrq;
+			pendingIrq &= ~irq;
+			if (irq & (SIM_IRQ_PCINT0 | SIM_IRQ_PCINT1 | SIM_IRQ_PCINT2))
+				PCIFR &= ~irq;
+
+			interruptsEnabled = false;
+			dispatch(irq);
+			interruptsEnabled = true;
+			served |= irq;
+		}
+
+		return served;
+	}
+
+	// ---------------------- //
+	//  clock
+	// ---------------------- //
+	static uint64_t timer0Next()
+	{
+		uint64_t from = max(cycles, sleepFloor);
+		return (from / SIM_TIMER0_PERIOD + 1) * SIM_TIMER0_PERIOD;
+	}
+
+	// Moves the clock to the next event before limit and fires it.
+	// Returns false when nothing is due before limit.
+	static bool step(uint64_t limit, bool sleeping)
+	{
+		uint64_t next = min(min(timer1Next, rtcNext), scriptNext);
+		uint64_t tick = sleeping ? timer0Next() : SIM_NEVER;
+
+		if (min(next, tick) > limit)
+			return false;
+
+		cycles = max(cycles, min(next, tick));
+
+		if (tick <= next)
+			raise(SIM_IRQ_TIMER0_OVF);
+		if (timer1Next <= cycles)
+			timer1Overflow();
+		if (rtcNext <= cycles)
+			rtcTick();
+		if (scriptNext <= cycles)
+			scriptFire();
+
+		return true;
+	}
+
+	void advance(uint64_t delta)
+	{
+		uint64_t target = cycles + delta;
+
+		while (step(target, false))
+			service();
+
+		cycles = target;
+		service();
+	}
+
+	void sleep()
+	{
+		// with acceleration the periodic interrupts keep running, they
+		// just don't end the sleep before wakeCycles have passed
+		sleepFloor = cycles + wakeCycles;
+		bool woken = false;
+
+		while (!woken && step(endCycles, true))
+		{
+			uint8_t served = service();
+
+			woken = served & (SIM_IRQ_PCINT0 | SIM_IRQ_PCINT1 | SIM_IRQ_PCINT2 | SIM_IRQ_USART_RX)
+				|| (served && cycles >= sleepFloor);
+		}
+
+		sleepFloor = 0;
+		if (!woken)
+			cycles = max(cycles, endCycles);
+	}
+
+	bool finished()
+	{
+		return cycles >= endCycles;
+	}
+
+	// ---------------------- //
+	//  port C inputs
+	// ---------------------- //
+	static void updatePortC()
+	{
+		uint8_t old = PINC;
+		PINC = (inputs & ~DDRC) | (PORTC & DDRC);
+
+		if ((old ^ PINC) & PCMSK1 && PCICR & _BV(PCIE1))
+		{
+			PCIFR |= _BV(PCIE1);
+			raise(SIM_IRQ_PCINT1);
+		}
+	}
+
+	void setInput(uint8_t bit, bool level)
+	{
+		if (level)
+			inputs |= _BV(bit);
+		else
+			inputs &= ~_BV(bit);
+
+		updatePortC();
+	}
+
+	bool input(uint8_t bit)
+	{
+		return inputs & _BV(bit);
+	}
+
+	// ---------------------- //
+	//  trace
+	// ---------------------- //
+	void stamp(char *buffer, unsigned size)
+	{
+		uint64_t ms = cycles / (F_CPU / 1000L);
+		snprintf(buffer, size, "[%3llud %02llu:%02llu:%02llu.%03llu]",
+			ms / 86400000ULL, ms / 3600000ULL % 24, ms / 60000ULL % 60,
+			ms / 1000ULL % 60, ms % 1000ULL);
+	}
+
+	void trace(const char *format, ...)
+	{
+		if (quiet)
+			return;
+
+		char prefix[32];
+		stamp(prefix, sizeof(prefix));
+		printf("%s ", prefix);
+
+		va_list args;
+		va_start(args, format);
+		vprintf(format, args);
+		va_end(args);
+		putchar('\n');
+	}
+}
+
+// ---------------------- //
+//  hardware stand-ins
+// ---------------------- //
+SimTimerCounter::operator uint16_t() const
+{
+	uint16_t prescale = sim::timer1Prescale();
+	if (!prescale)
+		return 0;
+
+	// virtual time since BOTTOM, which inside the mux ISR is how long
+	// its dispatch was held off
+	uint64_t counts = (sim::cycles - sim::timer1Last) / prescale;
+
+	if (sim::timer1InIsr && sim::hostScale > 0)
+	{
+		// plus the host time the ISR has run so far, scaled to the target
+		double ns = (double) (sim::hostNanos() - sim::timer1DispatchHost) * sim::hostScale;
+		counts += (uint64_t) (ns * (F_CPU / 1e9) / prescale);
+	}
+
+	// phase correct counts up to TOP, then back down
+	uint16_t top = sim::timer1Top;
+	counts %= 2ULL * top + 1;
+	return counts <= top ? counts : 2 * top - counts;
+}
+
+SimTimerCounter &SimTimerCounter::operator=(uint16_t value)
+{
+	if (!value)
+		sim::timer1Restart();
+	return *this;
+}
+
+void cli(void)
+{
+	sim::interruptsEnabled = false;
+	SREG &= ~0x80;
+}
+
+void sei(void)
+{
+	sim::interruptsEnabled = true;
+	SREG |= 0x80;
+	sim::service();
+}
+
+static bool sleepEnabled = false;
+
+void set_sleep_mode(uint8_t mode)
+{
+	SMCR = (SMCR & 0x01) | (mode << 1);
+}
+
+void sleep_enable(void)  { sleepEnabled = true; }
+void sleep_disable(void) { sleepEnabled = false; }
+
+void sleep_cpu(void)
+{
+	if (sleepEnabled)
+		sim::sleep();
+}
+
+void sleep_mode(void)
+{
+	sleep_enable();
+	sleep_cpu();
+	sleep_disable();
+}
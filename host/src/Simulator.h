@@ -0,0 +1,107 @@
+#ifndef Simulator_h
+#define Simulator_h
+
+#include <stdint.h>
+
+// ---------------------- //
+//  virtual clock
+// ---------------------- //
+// Time is counted in CPU cycles at F_CPU and only moves when the
+// firmware waits: delay(), sleep_cpu(), a fixed cost per loop()
+// iteration and a small cost per micros()/millis() call. Interrupt
+// sources raise their flag when due and are dispatched in vector order
+// as soon as interrupts are enabled, like on the chip.
+#define SIM_NEVER         UINT64_MAX
+#define SIM_TIMER0_PERIOD 16384 // cycles, 64 * 256
+#define SIM_CALL_COST     32    // cycles charged per micros()/millis()
+
+// interrupt flags, in vector priority order
+#define SIM_IRQ_PCINT0     0x01
+#define SIM_IRQ_PCINT1     0x02
+#define SIM_IRQ_PCINT2     0x04
+#define SIM_IRQ_TIMER1_OVF 0x08
+#define SIM_IRQ_TIMER0_OVF 0x10
+#define SIM_IRQ_USART_RX   0x20
+
+// simulated input pins
+#define SIM_BUTTON_A 0 // A0, PC0
+#define SIM_BUTTON_B 1 // A1, PC1
+#define SIM_MFP      3 // A3, PC3
+
+namespace sim
+{
+	// clock
+	extern uint64_t cycles;
+	extern uint64_t endCycles;
+	extern uint64_t wakeCycles;
+	extern double   hostScale;
+
+	uint64_t usToCycles(uint64_t us);
+	uint64_t msToCycles(uint64_t ms);
+
+	// Runs the clock forward, dispatching whatever falls due.
+	void advance(uint64_t delta);
+	// Runs until an interrupt wakes the CPU, or the run ends.
+	void sleep();
+	bool finished();
+
+	// interrupts
+	extern bool    interruptsEnabled;
+	extern uint8_t pendingIrq;
+	void raise(uint8_t irq);
+	uint8_t service();
+
+	// Timer1, programmed through TimerOne
+	extern void (*timer1Isr)();
+	extern uint64_t timer1Next;
+	extern uint64_t timer1DispatchHost; // host ns when the running ISR started
+	extern bool     timer1InIsr;
+	extern unsigned long timer1Count;
+	extern unsigned long timer1Missed;  // TOPs written below the running count
+	uint16_t timer1Prescale();
+	void timer1Restart();
+	// ICR1 or the prescaler changed while running
+	void timer1Retop();
+
+	// port C inputs
+	void setInput(uint8_t bit, bool level);
+	bool input(uint8_t bit);
+
+	// RTC model
+	extern uint64_t rtcNext;
+	extern bool     rtcTimeFails; // time reads fail, MFP stays high
+	void rtcBegin(uint32_t t);
+	void rtcTick();
+	void rtcUpdateMfp();
+	// SRAM and EEPROM contents, kept across runs in a file
+	bool rtcLoadMemory(const char *path);
+	bool rtcSaveMemory(const char *path);
+	extern unsigned long eepromWrites;
+
+	// thermometer model, 1/128 C
+	int16_t ambient();
+	void setAmbient(int16_t target, uint64_t rampCycles);
+
+	// Serial
+	void serialInject(const char *text);
+	extern unsigned long serialBytesOut;
+
+	// buzzer
+	extern unsigned long toneCount;
+	extern unsigned int  toneFrequency;
+
+	// script and trace
+	extern uint64_t scriptNext;
+	void scriptFire();
+	bool scriptLoad(const char *path);
+	bool parseDuration(const char *text, uint64_t &us);
+
+	extern bool quiet;
+	extern bool verbose;
+	void trace(const char *format, ...);
+	void stamp(char *buffer, unsigned size);
+
+	uint64_t hostNanos();
+}
+
+#endif
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "TelemetryDecoder.h"
+
+// Time.h renames time_t for the firmware, the dates below use the C
+// library's
+#undef time_t
+
+static const char *stateNames[] = {
+	"EDIT_TIME", "EDIT_ALARM", "SHOW_TIME", "SHOW_TEMP", "SHOW_ALARM", "ERROR"
+};
+
+static const char *eventNames[] = {
+	"click A", "double A", "long A", "click B", "double B", "long B", "timeout", "alarm"
+};
+
+static const char *timeStatusNames[] = {"not set", "needs sync", "set"};
+
+static const char *statusNames[] = {
+	"RTC has set the system time", "Unable to sync with the RTC",
+	"Error detected, buttons and RTC alarm disabled"
+};
+
+const char *telemetryStateName(uint8_t state)
+{
+	return state < sizeof(stateNames) / sizeof(*stateNames) ? stateNames[state] : "?";
+}
+
+const char *telemetryEventName(uint8_t event)
+{
+	return event < sizeof(eventNames) / sizeof(*eventNames) ? eventNames[event] : "?";
+}
+
+TelemetryDecoder::TelemetryDecoder()
+{
+	records      = 0;
+	badFrames    = 0;
+	_frameLength = 0;
+}
+
+void TelemetryDecoder::feed(uint8_t c)
+{
+	if (_frameLength)
+	{
+		_frame[_frameLength++] = c;
+		if (_frameLength == TELEMETRY_FRAME)
+			decode();
+		return;
+	}
+
+	if (c == TELEMETRY_SYNC)
+	{
+		_frame[_frameLength++] = c;
+	} else if (c == '\n')
+	{
+		emit(_text, false);
+		_text.clear();
+	} else if (c != '\r' && _text.size() < 255)
+	{
+		_text += (char) c;
+	}
+}
+
+bool TelemetryDecoder::next(std::string &line, bool &record)
+{
+	if (_lines.empty())
+		return false;
+
+	line   = _lines.front().text;
+	record = _lines.front().record;
+	_lines.pop_front();
+	return true;
+}
+
+void TelemetryDecoder::emit(const std::string &text, bool record)
+{
+	Line line = {text, record};
+	_lines.push_back(line);
+}
+
+static unsigned readWord(const uint8_t *p)
+{
+	return p[0] | p[1] << 8;
+}
+
+static int readInt(const uint8_t *p)
+{
+	return (int16_t) readWord(p);
+}
+
+void TelemetryDecoder::decode()
+{
+	_frameLength = 0;
+
+	if (telemetryCrc(_frame + 1, TELEMETRY_PAYLOAD + 1) != _frame[TELEMETRY_FRAME - 1])
+	{
+		// resync on whatever follows the false sync byte
+		badFrames++;
+		emit("telemetry: bad frame", true);
+		uint8_t rest[TELEMETRY_FRAME - 1];
+		for (size_t i = 1; i < TELEMETRY_FRAME; i++)
+			rest[i - 1] = _frame[i];
+		for (size_t i = 0; i < sizeof(rest); i++)
+			feed(rest[i]);
+		return;
+	}
+
+	records++;
+	const uint8_t *p = _frame + 2;
+	char text[128];
+
+	switch (_frame[1])
+	{
+		case TELEMETRY_TIME:
+		{
+			time_t t = (time_t) ((uint32_t) readWord(p) | (uint32_t) readWord(p + 2) << 16);
+			struct tm tm;
+			gmtime_r(&t, &tm);
+			snprintf(text, sizeof(text), "time %04d-%02d-%02d %02d:%02d:%02d, %s",
+				tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min,
+				tm.tm_sec, p[4] < 3 ? timeStatusNames[p[4]] : "?");
+			break;
+		}
+
+		case TELEMETRY_TEMPERATURE:
+			snprintf(text, sizeof(text), "temperature %.2f C, filtered %.2f C, level %u",
+				readInt(p) / 100.0, readInt(p + 2) / 100.0, p[4]);
+			break;
+
+		case TELEMETRY_ALARM:
+		{
+			char days[8] = "SMTWTFS";
+			for (int i = 0; i < 7; i++)
+				if (!(p[4] & (1 << i)))
+					days[i] = '-';
+			snprintf(text, sizeof(text), "alarm %u %02u:%02u %s, %s, %s", p[0], p[1], p[2],
+				p[3] & TELEMETRY_ALARM_ON ? "on" : "off",
+				p[3] & TELEMETRY_ALARM_REPEAT ? "repeat" : "once", days);
+			break;
+		}
+
+		case TELEMETRY_TRANSITION:
+			snprintf(text, sizeof(text), "fsm %s -%s-> %s, %u us", telemetryStateName(p[0]),
+				telemetryEventName(p[1]), telemetryStateName(p[2]), readWord(p + 3));
+			break;
+
+		case TELEMETRY_DROPPED:
+			snprintf(text, sizeof(text), "telemetry: %u records dropped", readWord(p));
+			break;
+
+		case TELEMETRY_DUTY:
+			snprintf(text, sizeof(text), "state %u: awake %u.%u%% of %u ms", p[0],
+				readWord(p + 1) / 10, readWord(p + 1) % 10, readWord(p + 3));
+			break;
+
+		case TELEMETRY_STATUS:
+			if (p[0] < sizeof(statusNames) / sizeof(*statusNames))
+				snprintf(text, sizeof(text), "%s", statusNames[p[0]]);
+			else
+				snprintf(text, sizeof(text), "telemetry: status %u", p[0]);
+			break;
+
+		default:
+			snprintf(text, sizeof(text), "telemetry: record type %u", _frame[1]);
+			break;
+	}
+
+	emit(text, true);
+}
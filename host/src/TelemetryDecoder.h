@@ -0,0 +1,46 @@
+#ifndef TelemetryDecoder_h
+#define TelemetryDecoder_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <string>
+
+#include <Telemetry.h>
+
+// Splits the firmware's serial output into text lines and telemetry
+// frames (see src/Telemetry.h), and turns each into one line of text.
+// A frame with a bad CRC is counted and its bytes scanned again for
+// the next sync byte.
+class TelemetryDecoder
+{
+	public:
+		TelemetryDecoder();
+
+		void feed(uint8_t c);
+		// the next complete line, and whether it came from a frame
+		bool next(std::string &line, bool &record);
+
+		unsigned long records;
+		unsigned long badFrames;
+
+	private:
+		struct Line
+		{
+			std::string text;
+			bool        record;
+		};
+
+		std::string       _text;
+		uint8_t           _frame[TELEMETRY_FRAME];
+		size_t            _frameLength;
+		std::deque<Line>  _lines;
+
+		void decode();
+		void emit(const std::string &text, bool record);
+};
+
+const char *telemetryStateName(uint8_t state);
+const char *telemetryEventName(uint8_t event);
+
+#endif
@@ -0,0 +1,98 @@
+#include <TimerOne.h>
+
+#include "Simulator.h"
+
+#define RESOLUTION 65536 // Timer1 is 16 bit
+
+TimerOne Timer1;
+void (*TimerOne::isrCallback)() = 0;
+
+void TimerOne::initialize(unsigned long microseconds)
+{
+	TCCR1B = _BV(WGM13); // phase and frequency correct PWM, stopped
+	TCCR1A = 0;
+	setPeriod(microseconds);
+}
+
+// same prescaler search as the library
+void TimerOne::setPeriod(unsigned long microseconds)
+{
+	const unsigned long cycles = (F_CPU / 2000000) * microseconds;
+	unsigned short pwmPeriod;
+	unsigned char clockSelectBits;
+
+	if (cycles < RESOLUTION)
+	{
+		clockSelectBits = _BV(CS10);
+		pwmPeriod = cycles;
+	} else if (cycles < RESOLUTION * 8)
+	{
+		clockSelectBits = _BV(CS11);
+		pwmPeriod = cycles / 8;
+	} else if (cycles < RESOLUTION * 64)
+	{
+		clockSelectBits = _BV(CS11) | _BV(CS10);
+		pwmPeriod = cycles / 64;
+	} else if (cycles < RESOLUTION * 256)
+	{
+		clockSelectBits = _BV(CS12);
+		pwmPeriod = cycles / 256;
+	} else if (cycles < RESOLUTION * 1024)
+	{
+		clockSelectBits = _BV(CS12) | _BV(CS10);
+		pwmPeriod = cycles / 1024;
+	} else
+	{
+		clockSelectBits = _BV(CS12) | _BV(CS10);
+		pwmPeriod = RESOLUTION - 1;
+	}
+
+	ICR1   = pwmPeriod;
+	TCCR1B = _BV(WGM13) | clockSelectBits;
+
+	// the counter keeps its phase, the next overflow follows the new TOP
+	if (sim::timer1Next == SIM_NEVER)
+		sim::timer1Restart();
+	else
+		sim::timer1Retop();
+}
+
+void TimerOne::start()
+{
+	restart();
+}
+
+void TimerOne::stop()
+{
+	TCCR1B = _BV(WGM13);
+	sim::timer1Next = SIM_NEVER;
+}
+
+void TimerOne::restart()
+{
+	TCNT1 = 0;
+}
+
+void TimerOne::resume()
+{
+	sim::timer1Restart();
+}
+
+void TimerOne::attachInterrupt(void (*isr)())
+{
+	isrCallback     = isr;
+	sim::timer1Isr  = isr;
+	TIMSK1 = _BV(TOIE1);
+}
+
+void TimerOne::attachInterrupt(void (*isr)(), unsigned long microseconds)
+{
+	if (microseconds > 0)
+		setPeriod(microseconds);
+	attachInterrupt(isr);
+}
+
+void TimerOne::detachInterrupt()
+{
+	TIMSK1 = 0;
+}
@@ -0,0 +1,170 @@
+// Runs the MexClk sketch on simulated time. See host/README.md.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <deque>
+#include <string>
+
+#include <Arduino.h>
+#include <Time.h>
+
+#include "Simulator.h"
+#include "TelemetryDecoder.h"
+
+#define DEFAULT_DURATION "1d"
+#define DEFAULT_START    "2017-01-02 06:55:00" // a monday
+#define DEFAULT_WAKE     "10ms"
+#define DEFAULT_LOOP     "100us"
+#define FSM_STATES       6
+
+extern byte fsmState;
+
+static bool isIdleState(byte state)
+{
+	return state == 2 || state == 3; // SHOW_TIME_MODE, SHOW_TEMP_MODE
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-t duration] [-s script] [-d \"YYYY-MM-DD hh:mm:ss\"] [-e]\n"
+		"          [-w wake] [-l loop] [-x scale] [-n file] [-q] [-v]\n"
+		"  -t  simulated time to run, default " DEFAULT_DURATION "\n"
+		"  -s  stimulus script, see src/Script.cpp\n"
+		"  -d  RTC time at power-up, default " DEFAULT_START "\n"
+		"  -e  RTC time reads fail and MFP stays high; SRAM and EEPROM\n"
+		"      still answer\n"
+		"  -w  shortest sleep the periodic interrupts can end, default " DEFAULT_WAKE ";\n"
+		"      0 wakes loop() on every interrupt like the chip does\n"
+		"  -l  CPU time charged per loop() iteration, default " DEFAULT_LOOP "\n"
+		"  -x  target/host speed ratio; TCNT1 read in the mux ISR then counts\n"
+		"      scaled host time, by default it stays at BOTTOM\n"
+		"  -n  RTC SRAM and EEPROM image, loaded at power-up if it exists and\n"
+		"      saved at the end, so a run can continue from a reset\n"
+		"  -q  only print the summary\n"
+		"  -v  also trace tones, button releases, the RTC MFP and the\n"
+		"      time/temperature display cycle\n", name);
+	exit(2);
+}
+
+static bool parseDate(const char *text, time_t &t)
+{
+	int y, mo, d, h, mi, s;
+	if (sscanf(text, "%d-%d-%d %d:%d:%d", &y, &mo, &d, &h, &mi, &s) != 6)
+		return false;
+
+	tmElements_t tm;
+	tm.Year   = CalendarYrToTm(y);
+	tm.Month  = mo;
+	tm.Day    = d;
+	tm.Hour   = h;
+	tm.Minute = mi;
+	tm.Second = s;
+	t = makeTime(tm);
+	return true;
+}
+
+static bool parseCycles(const char *text, uint64_t &cycles)
+{
+	uint64_t us;
+	if (!sim::parseDuration(text, us))
+		return false;
+	cycles = sim::usToCycles(us);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	const char *script = 0;
+	const char *memory = 0;
+	uint64_t duration, loopCost;
+	time_t start;
+
+	parseCycles(DEFAULT_DURATION, duration);
+	parseCycles(DEFAULT_WAKE, sim::wakeCycles);
+	parseCycles(DEFAULT_LOOP, loopCost);
+	parseDate(DEFAULT_START, start);
+
+	int opt;
+	while ((opt = getopt(argc, argv, "t:s:d:ew:l:x:n:qvh")) != -1)
+	{
+		bool ok = true;
+		switch (opt)
+		{
+			case 't': ok = parseCycles(optarg, duration); break;
+			case 's': script = optarg; break;
+			case 'd': ok = parseDate(optarg, start); break;
+			case 'e': sim::rtcTimeFails = true; break;
+			case 'w': ok = parseCycles(optarg, sim::wakeCycles); break;
+			case 'l': ok = parseCycles(optarg, loopCost); break;
+			case 'x': sim::hostScale = atof(optarg); break;
+			case 'n': memory = optarg; break;
+			case 'q': sim::quiet = true; break;
+			case 'v': sim::verbose = true; break;
+			default: usage(argv[0]);
+		}
+		if (!ok)
+			usage(argv[0]);
+	}
+
+	if (script && !sim::scriptLoad(script))
+		return 1;
+
+	// the display's constructor has already run, like on the chip
+	sim::endCycles = sim::cycles + duration;
+	sim::rtcBegin(start);
+	if (memory && !sim::rtcLoadMemory(memory))
+		return 1;
+
+	uint64_t hostStart = sim::hostNanos();
+	uint64_t stateCycles[FSM_STATES] = {0};
+	unsigned long transitions = 0;
+	unsigned long iterations  = 0;
+
+	sei();
+	setup();
+	byte state = fsmState;
+	sim::trace("fsm: start in %s", telemetryStateName(state));
+
+	while (!sim::finished())
+	{
+		uint64_t before = sim::cycles;
+		sim::advance(loopCost);
+		loop();
+		iterations++;
+
+		stateCycles[state % FSM_STATES] += sim::cycles - before;
+		if (fsmState != state)
+		{
+			// the idle time/temperature cycle is only shown with -v
+			if (sim::verbose || !(isIdleState(state) && isIdleState(fsmState)))
+				sim::trace("fsm: %s -> %s", telemetryStateName(state),
+					telemetryStateName(fsmState));
+			state = fsmState;
+			transitions++;
+		}
+	}
+
+	if (memory && !sim::rtcSaveMemory(memory))
+		return 1;
+
+	double hostSeconds = (sim::hostNanos() - hostStart) / 1e9;
+	double simSeconds  = (double) sim::cycles / F_CPU;
+
+	printf("\n-- simulated %.1f s in %.2f s host time (x%.0f)\n",
+		simSeconds, hostSeconds, simSeconds / (hostSeconds > 0 ? hostSeconds : 1e-9));
+	printf("   loop iterations %lu, mux interrupts %lu (%lu missed TOP), fsm transitions %lu\n",
+		iterations, sim::timer1Count, sim::timer1Missed, transitions);
+	printf("   serial bytes %lu, tones %lu, eeprom writes %lu\n", sim::serialBytesOut,
+		sim::toneCount, sim::eepromWrites);
+
+	for (byte i = 0; i < FSM_STATES; i++)
+	{
+		if (stateCycles[i])
+			printf("   %-10s %6.2f %%\n", telemetryStateName(i),
+				100.0 * stateCycles[i] / (sim::cycles ? sim::cycles : 1));
+	}
+
+	return 0;
+}
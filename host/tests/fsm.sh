@@ -0,0 +1,38 @@
+#!/bin/sh
+# Replays stimulus scripts through the simulator and compares the FSM
+# transitions each one traces with the .expected file beside it. Times
+# and dispatch costs are left out, only the order of transitions
+# counts. A "# args:" line in a script holds extra simulator options.
+#
+#   tests/fsm.sh [-u] <sim> <script>...
+#
+# -u rewrites the expected files from the current firmware instead.
+update=0
+if [ "$1" = "-u" ]; then
+	update=1
+	shift
+fi
+
+sim=$1
+shift
+status=0
+
+for script in "$@"; do
+	expected=${script%.txt}.expected
+	args=$(sed -n 's/^# args: //p' "$script")
+	actual=$($sim $args -s "$script" | sed -n \
+		-e 's/^\[[^]]*\] \(fsm: start in .*\)/\1/p' \
+		-e 's/^\[[^]]*\] \(fsm [A-Z_]* -[^>]*-> [A-Z_]*\), .*/\1/p')
+
+	if [ $update = 1 ]; then
+		printf '%s\n' "$actual" > "$expected"
+		echo "fsm: $expected written"
+	elif printf '%s\n' "$actual" | diff -u "$expected" - ; then
+		echo "fsm: $script, $(printf '%s\n' "$actual" | wc -l) lines as expected"
+	else
+		echo "fsm: $script differs from $expected"
+		status=1
+	fi
+done
+
+exit $status
@@ -0,0 +1,276 @@
+// Stress test of the display's double buffer: random updates of digits,
+// decimal points, digit enables and signs, each followed by commit(),
+// with mux ISR ticks run between every two calls. After every tick the
+// outputs must match the last committed frame exactly; anything else
+// is a torn frame. Run by `make test`.
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+#include <string>
+
+#include <Arduino.h>
+#include <SevenSegDisplay.h>
+
+#define UPDATES  20000
+#define MAX_GAP  3     // mux ticks between two calls, 0 to MAX_GAP - 1
+#define NO_DIGIT 0xFF
+
+// ---------------------- //
+//  74HC595 and pins
+// ---------------------- //
+// What the display drives, recorded instead of going to the ports.
+struct Outputs
+{
+	byte shifter;  // the byte as shifted in, LSB first
+	byte latched;
+	byte lit;      // digit anode on, NO_DIGIT for none
+	bool data;
+	bool colon;
+	bool degree;
+	bool twoLit;   // a digit was switched on over another
+};
+
+static Outputs out;
+
+template <byte DIGITS>
+class RecordingPins
+{
+	public:
+		static const byte digits = DIGITS;
+
+		void begin(bool) { out.lit = NO_DIGIT; }
+		void digitsOff() { out.lit = NO_DIGIT; }
+
+		void digitOn(byte digit)
+		{
+			if (out.lit != NO_DIGIT && out.lit != digit)
+				out.twoLit = true;
+			out.lit = digit;
+		}
+
+		void digitOff(byte digit)
+		{
+			if (out.lit == digit)
+				out.lit = NO_DIGIT;
+		}
+
+		void colon(bool on)  { out.colon = on; }
+		void degree(bool on) { out.degree = on; }
+		void latchHigh()     { out.latched = out.shifter; }
+		void latchLow()      {}
+		void data(bool high) { out.data = high; }
+		void clockPulse()    { out.shifter = (out.shifter >> 1) | (out.data << 7); }
+};
+
+// ---------------------- //
+//  expected frame
+// ---------------------- //
+template <byte DIGITS>
+struct Frame
+{
+	char value[DIGITS];
+	bool decimal[DIGITS];
+	bool enabled[DIGITS];
+	bool colon;
+	bool degree;
+};
+
+static const char values[] = "0123456789AEFHLnor- ";
+
+static unsigned long seed = 1;
+
+static unsigned nextRandom(unsigned range)
+{
+	seed = seed * 1103515245UL + 12345UL;
+	return (seed >> 16) % range;
+}
+
+template <byte DIGITS>
+class Tester
+{
+	public:
+		typedef SevenSegDisplay<RecordingPins<DIGITS> > Display;
+
+		Tester() : _ticks(0), _digit(0)
+		{
+			// a known frame to start from
+			_display.enableNumericDisplay();
+			for (byte i = 0; i < DIGITS; i++)
+			{
+				_display.writeDigit(i, (byte) 0);
+				_back.value[i]   = 0;
+				_back.decimal[i] = false;
+				_back.enabled[i] = true;
+			}
+			_display.commit();
+			_back.colon  = false;
+			_back.degree = false;
+			_front = _back;
+		}
+
+		bool run(unsigned long updates)
+		{
+			for (unsigned long u = 0; u < updates; u++)
+			{
+				if (!update())
+				{
+					printf("tearing: %u digits, torn frame after %lu updates, %lu ticks\n",
+						DIGITS, u, _ticks);
+					return false;
+				}
+			}
+
+			printf("tearing: %u digits, %lu updates, %lu mux ticks, no torn frame\n",
+				DIGITS, updates, _ticks);
+			return true;
+		}
+
+	private:
+		Display _display;
+		Frame<DIGITS> _front;
+		Frame<DIGITS> _back;
+		unsigned long _ticks;
+		byte _digit;
+
+		// one screen update the way the sketch does them
+		bool update()
+		{
+			switch (nextRandom(4))
+			{
+				case 0:
+					_display.enableClockDisplay();
+					for (byte i = 0; i < DIGITS; i++)
+					{
+						_back.enabled[i] = true;
+						_back.decimal[i] = false;
+					}
+					_back.colon  = true;
+					_back.degree = false;
+					break;
+
+				case 1:
+					_display.enableTempDisplay();
+					for (byte i = 0; i < DIGITS; i++)
+					{
+						_back.enabled[i] = i < 3;
+						_back.decimal[i] = i == 1;
+					}
+					_back.colon  = false;
+					_back.degree = true;
+					break;
+
+				case 2:
+					_display.enableNumericDisplay();
+					for (byte i = 0; i < DIGITS; i++)
+					{
+						_back.enabled[i] = true;
+						_back.decimal[i] = false;
+					}
+					_back.colon  = false;
+					_back.degree = false;
+					break;
+
+				default:
+					break;
+			}
+			if (!ticks())
+				return false;
+
+			for (byte i = 0; i < DIGITS; i++)
+			{
+				byte which = nextRandom(4);
+				if (which == 0)
+				{
+					char value = values[nextRandom(sizeof(values) - 1)];
+					_display.writeDigit(i, value);
+					_back.value[i] = value;
+				} else if (which == 1)
+				{
+					byte value = nextRandom(10);
+					_display.writeDigit(i, value);
+					_back.value[i] = value;
+				} else if (which == 2)
+				{
+					bool decimal = nextRandom(2);
+					if (decimal)
+						_display.enableDecimalPoint(i);
+					else
+						_display.disableDecimalPoint(i);
+					_back.decimal[i] = decimal;
+				} else
+				{
+					bool enabled = nextRandom(2);
+					if (enabled)
+						_display.enableDigit(i);
+					else
+						_display.disableDigit(i);
+					_back.enabled[i] = enabled;
+				}
+
+				if (!ticks())
+					return false;
+			}
+
+			if (nextRandom(2))
+			{
+				bool colon = nextRandom(2);
+				if (colon)
+					_display.enableColon();
+				else
+					_display.disableColon();
+				_back.colon = colon;
+				if (!ticks())
+					return false;
+			}
+
+			_display.commit();
+			_front = _back;
+			return ticks();
+		}
+
+		// a few mux ticks, each checked against the committed frame
+		bool ticks()
+		{
+			for (byte n = nextRandom(MAX_GAP); n > 0; n--)
+			{
+				Display::handle_interrupt();
+				_ticks++;
+
+				if (!check())
+					return false;
+
+				if (++_digit >= DIGITS)
+					_digit = 0;
+			}
+			return true;
+		}
+
+		bool check()
+		{
+			byte segments = sevenSegGlyph(_front.value[_digit]) & (_front.decimal[_digit] ? 0xFE : 0xFF);
+			byte lit = _front.enabled[_digit] ? _digit : NO_DIGIT;
+
+			bool ok = !out.twoLit && out.lit == lit && out.colon == _front.colon &&
+				out.degree == _front.degree && (lit == NO_DIGIT || out.latched == segments);
+
+			if (!ok)
+				printf("  digit %u: lit %d segments %02x colon %d degree %d, expected lit %d segments %02x "
+					"colon %d degree %d\n", _digit, out.lit == NO_DIGIT ? -1 : out.lit, out.latched,
+					out.colon, out.degree, lit == NO_DIGIT ? -1 : lit, segments, _front.colon,
+					_front.degree);
+			return ok;
+		}
+};
+
+int main(int argc, char **argv)
+{
+	unsigned long updates = argc > 1 ? strtoul(argv[1], 0, 10) : UPDATES;
+
+	// the testers build their displays, which start Timer1; the ticks
+	// are only ever run from here, interrupts stay off
+	Tester<4> four;
+	Tester<6> six;
+
+	bool ok = four.run(updates) && six.run(updates);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,396 @@
+// Times the firmware's hot paths on the host against reference copies
+// of the code they replaced, e.g. `make bench`. Host nanoseconds are not
+// AVR cycles: the port registers are plain memory and every access is a
+// load or store, where the chip has sbi/cbi and out. Only the ratios
+// between the rows of a section mean something, and they understate
+// what the compile-time paths save on the chip.
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <deque>
+#include <string>
+
+#include <Arduino.h>
+#include <SevenSegController.h>
+#include <AlarmScheduler.h>
+
+#include "../src/Simulator.h"
+
+#define BENCH_CALLS 1000000
+#define BENCH_RUNS  7
+
+// pins of the clock, as in MexClk.cpp
+#define DIGIT0_PIN 3
+#define DIGIT1_PIN 9
+#define DIGIT2_PIN 10
+#define DIGIT3_PIN 11
+#define COLON_PIN  5
+#define DEGREE_PIN 6
+#define LATCH_PIN  8
+#define CLOCK_PIN  2
+#define DATA_PIN   7
+
+static unsigned long calls = BENCH_CALLS;
+static double callOverhead = 0;
+
+// best of BENCH_RUNS, in ns per call, less the cost of calling an
+// empty body
+static double measure(void (*body)())
+{
+	double best = 0;
+	for (int run = 0; run < BENCH_RUNS; run++)
+	{
+		uint64_t start = sim::hostNanos();
+		for (unsigned long i = 0; i < calls; i++)
+			body();
+		double ns = (double) (sim::hostNanos() - start) / calls;
+
+		if (!run || ns < best)
+			best = ns;
+	}
+	return best - callOverhead;
+}
+
+static void report(const char *name, double ns, double reference)
+{
+	printf("  %-40s %8.2f ns  x%.2f\n", name, ns, reference / (ns > 0 ? ns : 1e-3));
+}
+
+static void empty()
+{
+	__asm__ __volatile__("" ::: "memory");
+}
+
+// ---------------------- //
+//  Arduino core
+// ---------------------- //
+// digitalWrite() and shiftOut() as the AVR core has them: three flash
+// table lookups per call, PWM turned off on timer pins, and the write
+// done with SREG saved. The host shim only keeps the write itself.
+#define NOT_ON_TIMER 0
+#define TIMER0A      1
+#define TIMER0B      2
+#define TIMER1A      3
+#define TIMER1B      4
+#define TIMER2A      5
+#define TIMER2B      6
+
+static volatile uint8_t coreTCCR0A, coreTCCR1A, coreTCCR2A;
+
+static const uint8_t corePinPort[20] PROGMEM = {
+	PD, PD, PD, PD, PD, PD, PD, PD, PB, PB, PB, PB, PB, PB, PC, PC, PC, PC, PC, PC
+};
+static const uint8_t corePinMask[20] PROGMEM = {
+	1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 1, 2, 4, 8, 16, 32
+};
+static const uint8_t corePinTimer[20] PROGMEM = {
+	NOT_ON_TIMER, NOT_ON_TIMER, NOT_ON_TIMER, TIMER2B, NOT_ON_TIMER, TIMER0B, TIMER0A, NOT_ON_TIMER,
+	NOT_ON_TIMER, TIMER1A, TIMER1B, TIMER2A, NOT_ON_TIMER, NOT_ON_TIMER,
+	NOT_ON_TIMER, NOT_ON_TIMER, NOT_ON_TIMER, NOT_ON_TIMER, NOT_ON_TIMER, NOT_ON_TIMER
+};
+
+static void coreTurnOffPwm(uint8_t timer)
+{
+	switch (timer)
+	{
+		case TIMER0A: coreTCCR0A &= ~_BV(7); break;
+		case TIMER0B: coreTCCR0A &= ~_BV(5); break;
+		case TIMER1A: coreTCCR1A &= ~_BV(7); break;
+		case TIMER1B: coreTCCR1A &= ~_BV(5); break;
+		case TIMER2A: coreTCCR2A &= ~_BV(7); break;
+		case TIMER2B: coreTCCR2A &= ~_BV(5); break;
+	}
+}
+
+static void __attribute__((noinline)) coreDigitalWrite(uint8_t pin, uint8_t val)
+{
+	uint8_t timer = pgm_read_byte(&corePinTimer[pin]);
+	uint8_t mask  = pgm_read_byte(&corePinMask[pin]);
+	uint8_t port  = pgm_read_byte(&corePinPort[pin]);
+
+	if (timer != NOT_ON_TIMER)
+		coreTurnOffPwm(timer);
+
+	volatile uint8_t *out = portOutputRegister(port);
+
+	// the core runs cli() here; the simulator's would dispatch on sei()
+	uint8_t oldSREG = SREG;
+	if (val == LOW)
+		*out &= ~mask;
+	else
+		*out |= mask;
+	SREG = oldSREG;
+}
+
+static void coreShiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t val)
+{
+	for (uint8_t i = 0; i < 8; i++)
+	{
+		coreDigitalWrite(dataPin, !!(val & (1 << i)));
+		coreDigitalWrite(clockPin, HIGH);
+		coreDigitalWrite(clockPin, LOW);
+	}
+}
+
+// ---------------------- //
+//  mux ISR
+// ---------------------- //
+// The mux ISR before the display work, with its translateDigit()
+// switch on every tick and every pin written through digitalWrite().
+static byte baselineTranslate(char digit)
+{
+	switch (digit)
+	{
+		case 0: case 'O': return B00000011;
+		case 1:           return B10011111;
+		case 2:           return B00100101;
+		case 3:           return B00001101;
+		case 4:           return B10011001;
+		case 5:           return B01001001;
+		case 6:           return B01000001;
+		case 7:           return B00011111;
+		case 8:           return B00000001;
+		case 9:           return B00001001;
+		case 'A': case 'R': return B00010001;
+		case 'a': case 'o': return B11000101;
+		case 'E':           return B01100001;
+		case 'f': case 'F': return B01110001;
+		case 'n':         return B11010101;
+		case 'N':         return B00010011;
+		case 'h':         return B11010001;
+		case 'l':         return B11100011;
+		case 'r':         return B11110101;
+		case 'u':         return B11000111;
+		default:          return B11111111;
+	}
+}
+
+struct BaselineMux
+{
+	int  muxPins[_NO_DIGITS];
+	char digitValues[_NO_DIGITS];
+	byte showDecimal[_NO_DIGITS];
+	byte digitStatus[_NO_DIGITS];
+	int  blinkCounter[_NO_DIGITS];
+	byte segments[_NO_DIGITS];    // translated on write, since user-002
+	volatile int selectedDigit;
+};
+
+static BaselineMux baseline = {
+	{DIGIT0_PIN, DIGIT1_PIN, DIGIT2_PIN, DIGIT3_PIN},
+	{1, 2, 5, 9}, {0xFF, 0xFF, 0xFF, 0xFF}, {1, 1, 1, 1}, {0, 0, 0, 0},
+	{B10011111, B00100101, B01001001, B00001001}, 0
+};
+
+// the segment byte of the selected digit, the way each version gets it
+static inline byte switchSegments(BaselineMux &m)
+{
+	return baselineTranslate(m.digitValues[m.selectedDigit]) & m.showDecimal[m.selectedDigit];
+}
+
+static inline byte glyphSegments(BaselineMux &m)
+{
+	return sevenSegGlyph(m.digitValues[m.selectedDigit]) & m.showDecimal[m.selectedDigit];
+}
+
+static inline byte frameSegments(BaselineMux &m)
+{
+	return m.segments[m.selectedDigit];
+}
+
+template <byte (*segments)(BaselineMux &)>
+static void __attribute__((noinline)) baselineMux()
+{
+	BaselineMux &m = baseline;
+	byte value = segments(m);
+	coreDigitalWrite(LATCH_PIN, LOW);
+	coreShiftOut(DATA_PIN, CLOCK_PIN, value);
+
+	coreDigitalWrite(m.muxPins[0], LOW);
+	coreDigitalWrite(m.muxPins[1], LOW);
+	coreDigitalWrite(m.muxPins[2], LOW);
+	coreDigitalWrite(m.muxPins[3], LOW);
+
+	if (m.digitStatus[m.selectedDigit] == _ENABLE_DIGIT)
+		coreDigitalWrite(m.muxPins[m.selectedDigit], HIGH);
+
+	coreDigitalWrite(LATCH_PIN, HIGH);
+
+	m.selectedDigit++;
+	m.selectedDigit %= _NO_DIGITS;
+}
+
+// only the segment byte, moving on to the next digit
+template <byte (*segments)(BaselineMux &)>
+static void __attribute__((noinline)) segmentsOnly()
+{
+	BaselineMux &m = baseline;
+	volatile byte value = segments(m);
+	(void) value;
+
+	m.selectedDigit++;
+	m.selectedDigit %= _NO_DIGITS;
+}
+
+typedef SevenSegDisplay<SevenSegPins<COLON_PIN, DEGREE_PIN, LATCH_PIN, DATA_PIN, CLOCK_PIN,
+	DIGIT0_PIN, DIGIT1_PIN, DIGIT2_PIN, DIGIT3_PIN> > StaticDisplay;
+
+static SevenSegController *runtimeDisplay;
+static StaticDisplay *staticDisplay;
+static double counterRead;
+
+static void readCounter()
+{
+	uint16_t count = TCNT1;
+	(void) count;
+}
+
+static void runtimeMux()
+{
+	SevenSegController::handle_interrupt();
+}
+
+static void staticMux()
+{
+	StaticDisplay::handle_interrupt();
+}
+
+template <class Display>
+static Display *makeDisplay(Display *display)
+{
+	display->writeMessage("1259");
+	display->commit();
+	display->enableClockDisplay();
+	return display;
+}
+
+static void benchMux()
+{
+	runtimeDisplay = makeDisplay(new SevenSegController(DIGIT0_PIN, DIGIT1_PIN, DIGIT2_PIN,
+		DIGIT3_PIN, COLON_PIN, DEGREE_PIN, LATCH_PIN, DATA_PIN, CLOCK_PIN));
+	staticDisplay  = makeDisplay(new StaticDisplay());
+
+	// the ISR reads TCNT1 for its cost tracking, a function call in the
+	// simulator and two loads on the chip
+	counterRead = measure(readCounter);
+
+	printf("mux ISR, one digit at full brightness (ISR less the TCNT1 shim):\n");
+	double reference = measure(baselineMux<switchSegments>);
+	report("baseline, digitalWrite and shiftOut", reference, reference);
+	report("SevenSegController, FastPin", measure(runtimeMux) - counterRead, reference);
+	report("SevenSegDisplay, SevenSegPins", measure(staticMux) - counterRead, reference);
+}
+
+static void benchSegments()
+{
+	printf("segment byte of a digit, per mux tick:\n");
+	double reference = measure(segmentsOnly<switchSegments>);
+	report("translateDigit() switch and mask", reference, reference);
+	report("sevenSegGlyph() table and mask", measure(segmentsOnly<glyphSegments>), reference);
+	report("frame buffer, translated on write", measure(segmentsOnly<frameSegments>), reference);
+
+	printf("original mux ISR, digitalWrite and shiftOut:\n");
+	reference = measure(baselineMux<switchSegments>);
+	report("translateDigit() switch per tick", reference, reference);
+	report("frame buffer", measure(baselineMux<frameSegments>), reference);
+}
+
+// ---------------------- //
+//  alarm check
+// ---------------------- //
+// loop() asks whether the alarm is due on every iteration. Originally
+// Alarm::isTriggered() broke both times down to compare hour and minute.
+struct BaselineAlarm
+{
+	time_t alarmTime;
+	bool   enabled;
+
+	bool isTriggered(time_t currentTime)
+	{
+		if (enabled)
+		{
+			tmElements_t hms_alarm;
+			tmElements_t hms_time;
+			breakTime(alarmTime,  hms_alarm);
+			breakTime(currentTime, hms_time);
+
+			if (hms_alarm.Minute == hms_time.Minute && hms_alarm.Hour == hms_time.Hour)
+				return true;
+		}
+		return false;
+	}
+};
+
+#define BENCH_TIME  1483340100UL // 2017-01-02 06:55:00, a monday
+#define BENCH_ALARM 1483340400UL // 07:00 the same day
+
+static BaselineAlarm baselineAlarm = {BENCH_ALARM, true};
+static Alarm wakeAlarm;
+static AlarmScheduler alarms;
+static volatile time_t loopTime = BENCH_TIME;
+static volatile bool triggered;
+
+static void baselineCheck()
+{
+	triggered = baselineAlarm.isTriggered(loopTime);
+}
+
+static void alarmCheck()
+{
+	triggered = wakeAlarm.isTriggered(loopTime);
+}
+
+static void schedulerCheck()
+{
+	triggered = alarms.isTriggered(loopTime);
+}
+
+static void benchAlarm()
+{
+	setTime(BENCH_TIME);
+	wakeAlarm.setAlarmTime(BENCH_ALARM);
+	wakeAlarm.enableAlarm();
+	alarms.setAlarmTime(0, BENCH_ALARM);
+	alarms.enableAlarm(0);
+
+	printf("alarm check per loop() iteration, outside the alarm minute:\n");
+	double reference = measure(baselineCheck);
+	report("baseline, breakTime() twice", reference, reference);
+	report("Alarm, next fire time compare", measure(alarmCheck), reference);
+	report("AlarmScheduler, head alarm compare", measure(schedulerCheck), reference);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-n calls]\n"
+		"  -n  calls per timed run, default %d\n", name, BENCH_CALLS);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+	while ((opt = getopt(argc, argv, "n:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 'n': calls = strtoul(optarg, 0, 10); break;
+			default: usage(argv[0]);
+		}
+	}
+	if (!calls)
+		usage(argv[0]);
+
+	callOverhead = 0;
+	callOverhead = measure(empty);
+	printf("best of %d runs of %lu calls, call overhead %.2f ns removed\n\n",
+		BENCH_RUNS, calls, callOverhead);
+
+	benchMux();
+	printf("\n");
+	benchSegments();
+	printf("\n");
+	benchAlarm();
+	return 0;
+}
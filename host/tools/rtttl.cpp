@@ -0,0 +1,251 @@
+// Compiles RTTTL ringtones into the song format of src/SongPlayer.h and
+// writes them as a C header, e.g. `make songs` for src/Songs.h. One
+// ringtone per line, "name:d=4,o=6,b=120:notes"; blank lines and lines
+// starting with '#' are skipped. Besides d, o and b the defaults take
+// g=<ms>, the silence cut from the end of every note (0 by default).
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <SongPlayer.h>
+
+#define MAX_REPEATS 16
+#define MAX_EVENTS  255
+#define MAX_NOTE    119 // B8, the top of SongPlayer's table
+
+struct Event
+{
+	int note;
+	int length;
+};
+
+struct Song
+{
+	std::string        name;
+	unsigned           wholeNote; // ms
+	unsigned           gap;       // ms
+	std::vector<Event> events;
+};
+
+static const char *path = "-";
+static int lineNumber = 0;
+
+static void fail(const char *message)
+{
+	fprintf(stderr, "%s:%d: %s\n", path, lineNumber, message);
+	exit(1);
+}
+
+static int readNumber(const char *&p)
+{
+	int value = 0;
+	while (isdigit((unsigned char) *p))
+		value = value * 10 + (*p++ - '0');
+	return value;
+}
+
+// 1, 2, 4 ... 32 to its log2
+static int noteValue(int duration)
+{
+	for (int value = 0; value <= 5; value++)
+		if (duration == 1 << value)
+			return value;
+	fail("note durations are 1, 2, 4, 8, 16 or 32");
+	return 0;
+}
+
+static void parseDefaults(const char *&p, Song &song, int &duration, int &octave)
+{
+	unsigned bpm = 63;
+
+	while (*p && *p != ':')
+	{
+		char key = tolower((unsigned char) *p++);
+		if (*p++ != '=')
+			fail("expected key=value in the defaults");
+
+		int value = readNumber(p);
+		switch (key)
+		{
+			case 'd': duration = value; break;
+			case 'o': octave   = value; break;
+			case 'b': bpm      = value; break;
+			case 'g': song.gap = value; break;
+			default: fail("unknown default");
+		}
+
+		if (*p == ',')
+			p++;
+	}
+
+	if (*p++ != ':')
+		fail("expected ':' after the defaults");
+	if (bpm < 4 || song.gap > 255)
+		fail("b must be 4 or more and g at most 255");
+
+	noteValue(duration);
+	song.wholeNote = 4 * 60000 / bpm;
+}
+
+static Event parseNote(const char *&p, int defaultDuration, int defaultOctave)
+{
+	static const int semitones[] = {9, 11, 0, 2, 4, 5, 7}; // a to g
+
+	int duration = isdigit((unsigned char) *p) ? readNumber(p) : defaultDuration;
+	char name = tolower((unsigned char) *p++);
+
+	Event event;
+	if (name == 'p')
+	{
+		event.note = SONG_REST;
+	} else if (name >= 'a' && name <= 'h')
+	{
+		// h is the German b
+		event.note = semitones[name == 'h' ? 1 : name - 'a'];
+		if (*p == '#')
+		{
+			event.note++;
+			p++;
+		}
+	} else
+	{
+		fail("expected a note");
+	}
+
+	event.length = noteValue(duration);
+	if (*p == '.')
+	{
+		event.length |= SONG_DOTTED;
+		p++;
+	}
+
+	int octave = isdigit((unsigned char) *p) ? readNumber(p) : defaultOctave;
+	if (event.note != SONG_REST)
+	{
+		// C4 is MIDI note 60
+		event.note += (octave + 1) * 12;
+		if (event.note < 12 || event.note > MAX_NOTE)
+			fail("note out of range");
+	}
+
+	// the dot is also seen after the octave
+	if (*p == '.')
+	{
+		event.length |= SONG_DOTTED;
+		p++;
+	}
+
+	return event;
+}
+
+static Song parseSong(const char *line)
+{
+	Song song;
+	song.gap = 0;
+
+	const char *p = strchr(line, ':');
+	if (!p)
+		fail("expected name:defaults:notes");
+
+	for (const char *c = line; c < p; c++)
+		song.name += isalnum((unsigned char) *c) ? *c : '_';
+	if (song.name.empty() || isdigit((unsigned char) song.name[0]))
+		song.name.insert(0, "song_");
+	p++;
+
+	int duration = 4, octave = 6;
+	parseDefaults(p, song, duration, octave);
+
+	while (*p)
+	{
+		Event event = parseNote(p, duration, octave);
+
+		// repeats of the last event only make it longer
+		Event *last = song.events.empty() ? 0 : &song.events.back();
+		if (last && last->note == event.note && (last->length & ~SONG_REPEATS) == event.length &&
+			(last->length >> 4) < MAX_REPEATS - 1)
+			last->length += 1 << 4;
+		else
+			song.events.push_back(event);
+
+		if (*p == ',')
+			p++;
+		else if (*p)
+			fail("expected ',' between notes");
+	}
+
+	if (song.events.empty() || song.events.size() > MAX_EVENTS)
+		fail("a song has 1 to 255 events");
+
+	return song;
+}
+
+static void writeSong(const Song &song)
+{
+	unsigned bytes = SONG_HEADER + song.events.size() * SONG_EVENT;
+	printf("// %u ms whole note, %u ms gap, %u bytes\n", song.wholeNote, song.gap, bytes);
+	printf("const byte %sSong[] PROGMEM = {\n", song.name.c_str());
+	printf("\t0x%02x, 0x%02x, %u, %u,\n", song.wholeNote & 0xFF, song.wholeNote >> 8, song.gap,
+		(unsigned) song.events.size());
+
+	for (size_t i = 0; i < song.events.size(); i++)
+		printf("%s%d, 0x%02x,%s", i % 6 ? " " : "\t", song.events[i].note,
+			song.events[i].length, i % 6 == 5 || i + 1 == song.events.size() ? "\n" : "");
+	printf("};\n\n");
+}
+
+int main(int argc, char **argv)
+{
+	FILE *in = stdin;
+	if (argc > 2 || (argc == 2 && argv[1][0] == '-'))
+	{
+		fprintf(stderr, "usage: %s [file.rtttl] > Songs.h\n", argv[0]);
+		return 2;
+	}
+
+	if (argc == 2)
+	{
+		path = argv[1];
+		if (!(in = fopen(path, "r")))
+		{
+			perror(path);
+			return 1;
+		}
+	}
+
+	std::vector<Song> songs;
+	char buffer[4096];
+
+	while (fgets(buffer, sizeof(buffer), in))
+	{
+		lineNumber++;
+
+		// drop all whitespace, RTTTL allows it anywhere
+		std::string line;
+		for (char *c = buffer; *c; c++)
+			if (!isspace((unsigned char) *c))
+				line += *c;
+
+		if (!line.empty() && line[0] != '#')
+			songs.push_back(parseSong(line.c_str()));
+	}
+
+	const char *name = strrchr(path, '/');
+	printf("// Generated by mexclk-rtttl from %s, do not edit.\n", name ? name + 1 : path);
+	printf("#ifndef SONGS_H\n#define SONGS_H\n#include \"SongPlayer.h\"\n\n");
+
+	for (size_t i = 0; i < songs.size(); i++)
+		writeSong(songs[i]);
+
+	printf("#define SONGS %u\n\n", (unsigned) songs.size());
+	printf("const byte *const songs[SONGS] PROGMEM = {\n");
+	for (size_t i = 0; i < songs.size(); i++)
+		printf("\t%sSong,\n", songs[i].name.c_str());
+	printf("};\n\n#endif\n");
+
+	return 0;
+}
@@ -0,0 +1,64 @@
+// Decodes the clock's serial output: telemetry frames become one line
+// each, text lines are passed through. Reads a capture file, or stdin,
+// e.g. from a port set up with `stty -F /dev/ttyUSB0 115200 raw`.
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../src/TelemetryDecoder.h"
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-r] [file]\n"
+		"  -r  records only, drop the text lines\n", name);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	bool recordsOnly = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "rh")) != -1)
+	{
+		switch (opt)
+		{
+			case 'r': recordsOnly = true; break;
+			default: usage(argv[0]);
+		}
+	}
+
+	if (argc - optind > 1)
+		usage(argv[0]);
+
+	FILE *in = stdin;
+	if (optind < argc && !(in = fopen(argv[optind], "rb")))
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+
+	TelemetryDecoder decoder;
+	std::string line;
+	bool record;
+	int c;
+
+	while ((c = getc(in)) != EOF)
+	{
+		decoder.feed(c);
+		while (decoder.next(line, record))
+		{
+			if (record || !recordsOnly)
+			{
+				printf("%s\n", line.c_str());
+				fflush(stdout);
+			}
+		}
+	}
+
+	if (decoder.badFrames)
+		fprintf(stderr, "%lu records, %lu bad frames\n", decoder.records, decoder.badFrames);
+
+	return 0;
+}
@@ -2,17 +2,12 @@
 
 Alarm::Alarm()
 {
-	// fill in structure with current time
-	time_t n = now();
-	tmElements_t alarmSetting;
-	breakTime(n, alarmSetting);
+	_weekdays = EVERY_DAY;
+	_repeat   = true;
 
 	// set alarm value to 00:00:00 (HH:MM:SS).
-	alarmSetting.Hour   = 0;
-	alarmSetting.Minute = 0;
-	alarmSetting.Second = 0;
-
-	setAlarmTime(makeTime(alarmSetting));
+	_minuteOfDay = 0;
+	reschedule(now());
 	disableAlarm();
 }
 
@@ -28,34 +23,85 @@ void Alarm::disableAlarm()
 
 void Alarm::setAlarmTime(time_t newTime)
 {
-	_alarmTime = newTime;
+	// only the hour and minute matter
+	_minuteOfDay = elapsedSecsToday(newTime) / SECS_PER_MIN;
+	reschedule(now());
 }
 
-time_t Alarm::getAlarmTime()
+time_t Alarm::getAlarmTime() const
 {
-	return _alarmTime;
+	return _nextFire;
 }
 
-bool Alarm::isTriggered(time_t currentTime)
+unsigned int Alarm::getMinuteOfDay() const
+{
+	return _minuteOfDay;
+}
+
+void Alarm::setWeekdays(byte mask)
+{
+	_weekdays = mask & EVERY_DAY;
+	reschedule(now());
+}
+
+byte Alarm::getWeekdays() const
 {
-	if (isEnabled())
+	return _weekdays;
+}
+
+void Alarm::setRepeat(bool repeat)
+{
+	_repeat = repeat;
+}
+
+bool Alarm::isRepeating() const
+{
+	return _repeat;
+}
+
+void Alarm::reschedule(time_t currentTime)
+{
+	scheduleNext(currentTime);
+}
+
+void Alarm::scheduleNext(time_t after)
+{
+	if (!_weekdays)
 	{
-		tmElements_t hms_alarm;
-		tmElements_t hms_time;
-		breakTime(_alarmTime,  hms_alarm);
-		breakTime(currentTime, hms_time);
-
-		if (hms_alarm.Minute == hms_time.Minute &&
-			hms_alarm.Hour == hms_time.Hour)
-		{
-			return true;
-		}
+		_nextFire = ALARM_NEVER;
+		return;
 	}
 
-	return false;
+	// first alarm minute that has not fully passed at 'after',
+	// on one of the selected weekdays
+	_nextFire = previousMidnight(after) + _minuteOfDay * SECS_PER_MIN;
+
+	if (_nextFire + SECS_PER_MIN <= after)
+		_nextFire += SECS_PER_DAY;
+
+	while (!(_weekdays & (1 << (dayOfWeek(_nextFire) - 1))))
+		_nextFire += SECS_PER_DAY;
+}
+
+bool Alarm::isTriggered(time_t currentTime)
+{
+	// all that runs on every loop until the alarm minute comes
+	if (currentTime < _nextFire)
+		return false;
+
+	// fire once, anywhere inside the alarm minute, then move on to the
+	// next selected day. A minute that went by unseen, e.g. after the
+	// clock was moved forward, is skipped without firing.
+	bool fire = _enabled && (currentTime - _nextFire) < SECS_PER_MIN;
+	scheduleNext(max(currentTime, _nextFire + SECS_PER_MIN));
+
+	if (fire && !_repeat)
+		disableAlarm();
+
+	return fire;
 }
 
-bool Alarm::isEnabled()
+bool Alarm::isEnabled() const
 {
 	return _enabled;
 }
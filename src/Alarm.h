@@ -2,6 +2,13 @@
 #define ALARM_H
 #include <Time.h>
 
+#define ALARM_NEVER ((time_t) -1)
+
+// weekday masks, bit 0 is Sunday as in weekday() - 1
+#define EVERY_DAY 0x7F
+#define WEEKDAYS  0x3E
+#define WEEKENDS  0x41
+
 class Alarm
 {
 	public:
@@ -9,13 +16,27 @@ class Alarm
 		void enableAlarm();
 		void disableAlarm();
 		void setAlarmTime(time_t newTime);
-		time_t getAlarmTime();
-		bool isEnabled();
+		time_t getAlarmTime() const;
+		// the set hour and minute, even with no day to fire on
+		unsigned int getMinuteOfDay() const;
+		void setWeekdays(byte mask);
+		byte getWeekdays() const;
+		// a one-shot alarm disables itself once it fired
+		void setRepeat(bool repeat);
+		bool isRepeating() const;
+		bool isEnabled() const;
 		bool isTriggered(time_t currentTime);
+		// recompute the next fire time after the clock was set
+		void reschedule(time_t currentTime);
 
 	private:
-		time_t _alarmTime;
+		unsigned int _minuteOfDay; // 0 to 1439
+		time_t _nextFire;          // start of the next matching minute
+		byte   _weekdays;
+		bool   _repeat;
 		bool   _enabled;
+
+		void scheduleNext(time_t after);
 };
 
 #endif
@@ -0,0 +1,170 @@
+#include <MCP79412RTC.h>
+#include "AlarmScheduler.h"
+
+AlarmScheduler::AlarmScheduler()
+{
+	_triggered  = 0;
+	_rtcAlarm   = NO_RTC_ALARM;
+	_rtcFire    = ALARM_NEVER;
+	_rtcLate    = false;
+	_rtcMatched = false;
+
+	for (byte i = 0; i < MAX_ALARMS; i++)
+		_order[i] = i;
+
+	sortAlarms(now());
+}
+
+const Alarm &AlarmScheduler::getAlarm(byte index)
+{
+	return _alarms[index];
+}
+
+void AlarmScheduler::enableAlarm(byte index)
+{
+	// a disabled alarm is not kept up to date, catch up first
+	_alarms[index].reschedule(now());
+	_alarms[index].enableAlarm();
+	sortAlarms(now());
+}
+
+void AlarmScheduler::disableAlarm(byte index)
+{
+	_alarms[index].disableAlarm();
+	sortAlarms(now());
+}
+
+void AlarmScheduler::setAlarmTime(byte index, time_t newTime)
+{
+	_alarms[index].setAlarmTime(newTime);
+	sortAlarms(now());
+}
+
+void AlarmScheduler::setWeekdays(byte index, byte mask)
+{
+	_alarms[index].setWeekdays(mask);
+	sortAlarms(now());
+}
+
+void AlarmScheduler::setRepeat(byte index, bool repeat)
+{
+	_alarms[index].setRepeat(repeat);
+}
+
+void AlarmScheduler::reschedule(time_t currentTime)
+{
+	for (byte i = 0; i < MAX_ALARMS; i++)
+		_alarms[i].reschedule(currentTime);
+
+	sortAlarms(currentTime);
+
+	// a match still pending was made against the old clock
+	_rtcMatched = false;
+}
+
+bool AlarmScheduler::isTriggered(time_t currentTime)
+{
+	if (_rtcAlarm != NO_RTC_ALARM)
+	{
+		if (_rtcMatched)
+		{
+			// clear the RTC flag, which releases the MFP line
+			_rtcMatched = false;
+			RTC.alarm(_rtcAlarm);
+
+			// the RTC has the final say, even if now() lags it a little
+			if (currentTime < _headFire)
+				currentTime = _headFire;
+		} else if (!_rtcLate)
+		{
+			return false;
+		}
+	}
+
+	// all that runs on every loop until the head alarm is due
+	if (currentTime < _headFire)
+		return false;
+
+	byte head = _order[0];
+	bool fire = _alarms[head].isTriggered(currentTime);
+
+	if (fire)
+		_triggered = head;
+
+	// the head moved on to its next day, or disabled itself
+	sortAlarms(currentTime);
+
+	return fire;
+}
+
+byte AlarmScheduler::getTriggeredAlarm()
+{
+	return _triggered;
+}
+
+void AlarmScheduler::useRtcAlarm(uint8_t alarmNumber)
+{
+	_rtcAlarm = alarmNumber;
+	reschedule(now());
+}
+
+void AlarmScheduler::rtcInterrupt()
+{
+	_rtcMatched = true;
+}
+
+time_t AlarmScheduler::fireTime(byte index)
+{
+	return _alarms[index].isEnabled() ? _alarms[index].getAlarmTime() : ALARM_NEVER;
+}
+
+void AlarmScheduler::sortAlarms(time_t currentTime)
+{
+	// insertion sort, the table is short and nearly always in order
+	for (byte i = 1; i < MAX_ALARMS; i++)
+	{
+		byte entry = _order[i];
+		byte j = i;
+
+		while (j > 0 && fireTime(_order[j - 1]) > fireTime(entry))
+		{
+			_order[j] = _order[j - 1];
+			j--;
+		}
+
+		_order[j] = entry;
+	}
+
+	_headFire = fireTime(_order[0]);
+	programRtc(currentTime);
+}
+
+void AlarmScheduler::programRtc(time_t currentTime)
+{
+	if (_rtcAlarm == NO_RTC_ALARM)
+		return;
+
+	// a full date and time match, the RTC has no hour+minute mask
+	if (_headFire != ALARM_NEVER)
+	{
+		RTC.setAlarm(_rtcAlarm, _headFire);
+		RTC.enableAlarm(_rtcAlarm, ALM_MATCH_DATETIME);
+	} else
+	{
+		RTC.enableAlarm(_rtcAlarm, ALM_DISABLE);
+	}
+
+	// A match not yet taken, say while an edit mode ignored alarms, was
+	// for the old time. Reprogramming has released the MFP; drop it
+	// like a software alarm that was moved before it was polled.
+	if (_headFire != _rtcFire)
+	{
+		_rtcMatched = false;
+		_rtcFire    = _headFire;
+	}
+
+	// An alarm sharing the minute of the one that just rang is due
+	// already; the RTC matches the second exactly and would let it pass,
+	// so it is polled like a software alarm.
+	_rtcLate = _headFire != ALARM_NEVER && _headFire <= currentTime;
+}
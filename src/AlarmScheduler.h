@@ -0,0 +1,50 @@
+#ifndef ALARM_SCHEDULER_H
+#define ALARM_SCHEDULER_H
+#include "Alarm.h"
+
+#define MAX_ALARMS   4
+#define NO_RTC_ALARM 255
+
+// A table of alarms kept ordered by next fire time, so that polling
+// only ever compares against the head entry. Alarms are edited
+// through the scheduler, which restores the order after each change.
+class AlarmScheduler
+{
+	public:
+		AlarmScheduler();
+		const Alarm &getAlarm(byte index);
+		void enableAlarm(byte index);
+		void disableAlarm(byte index);
+		void setAlarmTime(byte index, time_t newTime);
+		void setWeekdays(byte index, byte mask);
+		void setRepeat(byte index, bool repeat);
+		// recompute every next fire time after the clock was set
+		void reschedule(time_t currentTime);
+
+		bool isTriggered(time_t currentTime);
+		// index of the alarm isTriggered() last reported
+		byte getTriggeredAlarm();
+
+		// Hand the matching of the head alarm over to an MCP79412 alarm
+		// (ALARM_0 or ALARM_1), whose MFP interrupt must call
+		// rtcInterrupt(). isTriggered() then only looks at that flag,
+		// unless the head was already due when the RTC was set.
+		void useRtcAlarm(uint8_t alarmNumber);
+		void rtcInterrupt();
+
+	private:
+		Alarm  _alarms[MAX_ALARMS];
+		byte   _order[MAX_ALARMS]; // alarm indexes, soonest first
+		time_t _headFire;          // ALARM_NEVER when all are disabled
+		byte   _triggered;
+		uint8_t _rtcAlarm;         // NO_RTC_ALARM when matched in software
+		time_t  _rtcFire;          // what the RTC alarm was last set to
+		bool    _rtcLate;          // the head was due before it was set, not matched
+		volatile bool _rtcMatched;
+
+		time_t fireTime(byte index);
+		void sortAlarms(time_t currentTime);
+		void programRtc(time_t currentTime);
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "Button.h"
+
+// classifier states
+#define BUTTON_IDLE     0
+#define BUTTON_PRESSED  1 // first press, still down
+#define BUTTON_RELEASED 2 // first press over, a second one may follow
+#define BUTTON_SECOND   3 // second press, still down
+#define BUTTON_LONG     4 // long press reported, waiting for release
+
+Button::Button(uint8_t pin)
+{
+	pinMode(pin, INPUT_PULLUP);
+	_mask = digitalPinToBitMask(pin);
+
+	_debounceTicks = 50;
+	_clickTicks    = 600;
+	_pressTicks    = 1000;
+
+	_clickFunc          = NULL;
+	_doubleClickFunc    = NULL;
+	_longPressStartFunc = NULL;
+
+	_raw        = false;
+	_rawTime    = 0;
+	_pressed    = false;
+	_state      = BUTTON_IDLE;
+	_startTime  = 0;
+}
+
+void Button::setClickTicks(unsigned int ticks)
+{
+	_clickTicks = ticks;
+}
+
+void Button::setPressTicks(unsigned int ticks)
+{
+	_pressTicks = ticks;
+}
+
+void Button::attachClick(buttonCallback callback)
+{
+	_clickFunc = callback;
+}
+
+void Button::attachDoubleClick(buttonCallback callback)
+{
+	_doubleClickFunc = callback;
+}
+
+void Button::attachLongPressStart(buttonCallback callback)
+{
+	_longPressStartFunc = callback;
+}
+
+void Button::edge(byte pins, unsigned long time)
+{
+	settle(time);
+
+	// active low
+	bool raw = !(pins & _mask);
+	if (raw != _raw)
+	{
+		_raw     = raw;
+		_rawTime = time;
+	}
+}
+
+void Button::tick(unsigned long now)
+{
+	settle(now);
+}
+
+void Button::settle(unsigned long time)
+{
+	// a change counts once the pin stayed there for the debounce time,
+	// from when it happened
+	if (_raw != _pressed && time - _rawTime >= _debounceTicks)
+	{
+		expire(_rawTime);
+		change(_raw, _rawTime);
+	}
+
+	expire(time);
+}
+
+void Button::expire(unsigned long time)
+{
+	if (_state == BUTTON_PRESSED && time - _startTime > _pressTicks)
+	{
+		_state = BUTTON_LONG;
+		if (_longPressStartFunc)
+			_longPressStartFunc();
+
+	} else if (_state == BUTTON_RELEASED && time - _startTime > _clickTicks)
+	{
+		_state = BUTTON_IDLE;
+		if (_clickFunc)
+			_clickFunc();
+	}
+}
+
+void Button::change(bool pressed, unsigned long time)
+{
+	_pressed = pressed;
+
+	switch (_state)
+	{
+		case BUTTON_IDLE:
+			if (pressed)
+			{
+				_state     = BUTTON_PRESSED;
+				_startTime = time;
+			}
+			break;
+
+		case BUTTON_PRESSED:
+			if (pressed)
+				break;
+			if (_doubleClickFunc)
+			{
+				_state = BUTTON_RELEASED;
+				break;
+			}
+			// nothing to wait for
+			_state = BUTTON_IDLE;
+			if (_clickFunc)
+				_clickFunc();
+			break;
+
+		case BUTTON_RELEASED:
+			if (pressed)
+				_state = BUTTON_SECOND;
+			break;
+
+		case BUTTON_SECOND:
+			if (!pressed)
+			{
+				_state = BUTTON_IDLE;
+				if (_doubleClickFunc)
+					_doubleClickFunc();
+			}
+			break;
+
+		case BUTTON_LONG:
+			if (!pressed)
+				_state = BUTTON_IDLE;
+			break;
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef BUTTON_H
+#define BUTTON_H
+#include <Arduino.h>
+
+typedef void (*buttonCallback)();
+
+// Click, double click and long press detection for an active-low
+// button, fed with timestamped edges instead of polling the pin, so
+// the outcome does not depend on how often loop() comes around. The
+// timings are OneButton's: presses shorter than the debounce time are
+// ignored, a second press must start within clickTicks of the first,
+// and a press becomes long once held for pressTicks.
+class Button
+{
+	public:
+		Button(uint8_t pin);
+		void setClickTicks(unsigned int ticks);
+		void setPressTicks(unsigned int ticks);
+		void attachClick(buttonCallback callback);
+		void attachDoubleClick(buttonCallback callback);
+		void attachLongPressStart(buttonCallback callback);
+
+		// An edge: the input port sampled at time, by the pin change ISR.
+		// Edges must be handed over in the order they happened.
+		void edge(byte pins, unsigned long time);
+		// Handles the timeouts due by now, once every edge up to now has
+		// been handed over.
+		void tick(unsigned long now);
+
+	private:
+		byte _mask;
+		unsigned int _debounceTicks;
+		unsigned int _clickTicks;
+		unsigned int _pressTicks;
+
+		buttonCallback _clickFunc;
+		buttonCallback _doubleClickFunc;
+		buttonCallback _longPressStartFunc;
+
+		bool _raw;                 // pressed, as of the last edge
+		unsigned long _rawTime;    // of the last change of _raw
+		bool _pressed;             // debounced
+		byte _state;
+		unsigned long _startTime;  // of the first press
+
+		void settle(unsigned long time);
+		void expire(unsigned long time);
+		void change(bool pressed, unsigned long time);
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef EDGE_QUEUE_H
+#define EDGE_QUEUE_H
+#include <Arduino.h>
+
+#define EDGE_QUEUE_SIZE 16 // entries, a power of two
+
+struct Edge
+{
+	unsigned long time; // millis() at the change
+	byte pins;          // input port, read in the same interrupt
+};
+
+// Ring of timestamped pin changes, filled by a pin change ISR and
+// drained by loop(). The ISR only writes _head and loop() only writes
+// _tail, both single bytes, so neither side has to block the other.
+// When the ring is full the new edge is dropped and the overflow flag
+// set, so the reader can resync from the live pins.
+class EdgeQueue
+{
+	public:
+		EdgeQueue() : _head(0), _tail(0), _overflow(false) {}
+
+		// interrupt context only
+		inline void push(byte pins, unsigned long time)
+		{
+			byte next = (_head + 1) & (EDGE_QUEUE_SIZE - 1);
+			if (next == _tail)
+			{
+				_overflow = true;
+				return;
+			}
+			_edges[_head].pins = pins;
+			_edges[_head].time = time;
+			_head = next;
+		}
+
+		// Position the ISR will write next. Taken together with millis()
+		// under noInterrupts(), it splits the edges into those up to that
+		// time and those after it.
+		inline byte head() { return _head; }
+
+		// pops the oldest edge, unless the queue is drained up to end
+		inline bool pop(Edge &edge, byte end)
+		{
+			if (_tail == end)
+				return false;
+			edge.pins = _edges[_tail].pins;
+			edge.time = _edges[_tail].time;
+			_tail = (_tail + 1) & (EDGE_QUEUE_SIZE - 1);
+			return true;
+		}
+
+		// reads and clears the overflow flag, with interrupts disabled
+		inline bool overflowed()
+		{
+			bool lost = _overflow;
+			_overflow = false;
+			return lost;
+		}
+
+	private:
+		volatile Edge _edges[EDGE_QUEUE_SIZE];
+		volatile byte _head;
+		volatile byte _tail;
+		volatile bool _overflow;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef FastPin_h
+#define FastPin_h
+
+#include <Arduino.h>
+
+// Output pin with its port register and bit mask looked up once, so
+// writes from the mux interrupt skip the digitalWrite() table lookups
+// and PWM checks. Only use from interrupt context (or with interrupts
+// disabled): high() and low() are read-modify-write on the port.
+class FastPin
+{
+	public:
+		FastPin() : _out(0), _mask(0) {}
+
+		// makes pin a low output
+		explicit FastPin(uint8_t pin)
+		{
+			pinMode(pin, OUTPUT);
+			// digitalWrite also turns off any PWM left on the pin's timer,
+			// which the direct port writes below would not do.
+			digitalWrite(pin, LOW);
+
+			_out  = portOutputRegister(digitalPinToPort(pin));
+			_mask = digitalPinToBitMask(pin);
+		}
+
+		inline void high() { *_out |= _mask; }
+		inline void low()  { *_out &= ~_mask; }
+
+	protected:
+		volatile uint8_t *_out;
+		uint8_t _mask;
+};
+
+// FastPin that also keeps its input register, for toggle()
+class FastTogglePin : public FastPin
+{
+	public:
+		FastTogglePin() : _in(0) {}
+		explicit FastTogglePin(uint8_t pin) : FastPin(pin), _in(portInputRegister(digitalPinToPort(pin))) {}
+
+		// writing a one to PINx toggles the output in a single cycle
+		inline void toggle() { *_in = _mask; }
+
+	private:
+		volatile uint8_t *_in;
+};
+
+// ATmega328p pin numbers to port and bit at compile time: 0-7 are
+// PD0-7, 8-13 PB0-5 and A0-A5 (14-19) PC0-5.
+constexpr uint8_t staticPinPort(uint8_t pin)
+{
+	return pin < 8 ? PD : pin < 14 ? PB : PC;
+}
+
+constexpr uint8_t staticPinMask(uint8_t pin)
+{
+	return 1 << (pin < 8 ? pin : pin < 14 ? pin - 8 : pin - 14);
+}
+
+// bits of the given pins that are on port
+constexpr uint8_t staticPortMask(uint8_t)
+{
+	return 0;
+}
+
+template <class... Pins>
+constexpr uint8_t staticPortMask(uint8_t port, uint8_t pin, Pins... pins)
+{
+	return (staticPinPort(pin) == port ? staticPinMask(pin) : 0) | staticPortMask(port, pins...);
+}
+
+// with a constant port these fold to the register itself
+inline volatile uint8_t &staticPortOutput(uint8_t port)
+{
+	return port == PB ? PORTB : port == PC ? PORTC : PORTD;
+}
+
+inline volatile uint8_t &staticPortInput(uint8_t port)
+{
+	return port == PB ? PINB : port == PC ? PINC : PIND;
+}
+
+// FastPin with the pin fixed at compile time: no RAM, and every write
+// is a single sbi, cbi or out. The same interrupt caveat applies.
+template <uint8_t pin>
+class StaticPin
+{
+	static_assert(pin < 20, "not an ATmega328p pin");
+
+	public:
+		static void begin()
+		{
+			pinMode(pin, OUTPUT);
+			digitalWrite(pin, LOW);
+		}
+
+		static inline void high()   { staticPortOutput(staticPinPort(pin)) |= staticPinMask(pin); }
+		static inline void low()    { staticPortOutput(staticPinPort(pin)) &= ~staticPinMask(pin); }
+		static inline void toggle() { staticPortInput(staticPinPort(pin)) = staticPinMask(pin); }
+};
+
+// A run-time index into pins fixed at compile time. The index is
+// compared against each position in turn and the match is one sbi or
+// cbi; there is no table to load from, in RAM or in flash.
+template <uint8_t index, uint8_t... pins>
+struct StaticPinArrayFrom
+{
+	static inline void begin() {}
+	static inline void high(uint8_t) {}
+	static inline void low(uint8_t) {}
+};
+
+template <uint8_t index, uint8_t pin, uint8_t... rest>
+struct StaticPinArrayFrom<index, pin, rest...>
+{
+	typedef StaticPinArrayFrom<index + 1, rest...> Next;
+
+	static inline void begin()
+	{
+		StaticPin<pin>::begin();
+		Next::begin();
+	}
+
+	static inline void high(uint8_t i) { if (i == index) StaticPin<pin>::high(); else Next::high(i); }
+	static inline void low(uint8_t i)  { if (i == index) StaticPin<pin>::low(); else Next::low(i); }
+};
+
+template <uint8_t... pins>
+using StaticPinArray = StaticPinArrayFrom<0, pins...>;
+
+#endif
@@ -1,14 +1,20 @@
 #include <DallasTemperature.h>
 #include <MCP79412RTC.h>
-#include <OneButton.h>
 #include <OneWire.h>
 #include <Time.h>
 #include <TimerOne.h>
 #include <Wire.h>
+#include <avr/sleep.h>
 
 #include "MexClk.h"
-#include "SevenSegController.h"
-#include "Alarm.h"
+#include "SevenSegDisplay.h"
+#include "AlarmScheduler.h"
+#include "Button.h"
+#include "EdgeQueue.h"
+#include "Telemetry.h"
+#include "SettingsStore.h"
+#include "SongPlayer.h"
+#include "Songs.h"
 
 // ---------------------- //
 //  display control pins
@@ -23,18 +29,54 @@
 #define CLOCK_PIN  2
 #define DATA_PIN   7
 #define ALARM_PIN  A3
+#define BUZZER_PIN A2
+#define DISPLAY_REFRESH_RATE 200 // Hz, whole display
 
 
+// ---------------------- //
+//  RTC MFP
+// ---------------------- //
+// The MCP79412 MFP output drives ALARM_PIN, through the pin change
+// interrupt. It can do one of two jobs:
+//  MFP_SQUARE_WAVE: 1 Hz square wave the seconds are counted from. The
+//    RTC is only read over I2C every RTC_RESYNC_PERIOD seconds, or when
+//    no tick arrived for RTC_TICK_TIMEOUT ms.
+//  MFP_ALARM: asserted low on an ALM0 match, so the wake-up alarm is
+//    never polled. The time is synced over I2C every second.
+#define MFP_SQUARE_WAVE   0
+#define MFP_ALARM         1
+#ifndef MFP_MODE
+#define MFP_MODE          MFP_SQUARE_WAVE
+#endif
+#define MFP_MASK          _BV(3) // A3 is PC3, PCINT11
+#define RTC_RESYNC_PERIOD 3600
+#define RTC_TICK_TIMEOUT  1500
+
 // ---------------------- //
 //  Thermometer
 // ---------------------- //
 #define ONE_WIRE_BUS 4
 
+// Sampling levels, from fast and coarse to slow and precise. The level
+// drops to 0 when the temperature moves and climbs back one step per
+// quiet sample.
+#define TEMP_LEVELS      4
+#define TEMP_EMA_SHIFT   2  // filter weight of a new sample, 1/4
+#define TEMP_FAST_DELTA 25  // 0.01 C between sample and filter that count as moving
+#define TEMP_SLOW_DELTA  6  // 0.01 C under which the temperature counts as stable
+
+const byte          tempResolution[TEMP_LEVELS] = {10, 11, 12, 12};
+const unsigned long tempInterval  [TEMP_LEVELS] = {2000, 5000, 15000, 60000};
+
 // ---------------------- //
 //  button pins
 // ---------------------- //
 #define BUTTON_A_PIN A0
 #define BUTTON_B_PIN A1
+// Both buttons share PCINT1 with the MFP. The ISR queues every change
+// with its millis() time and loop() classifies them from the queue, so
+// a long stall delays the click callbacks but does not change them.
+#define BUTTON_MASK  (_BV(0) | _BV(1)) // A0 and A1 are PC0 and PC1
 
 // ---------------------- //
 //  FSM definitions
@@ -45,75 +87,169 @@
 #define SHOW_TEMP_MODE  3
 #define SHOW_ALARM_MODE 4
 #define ERROR_MODE      5
+#define FSM_STATES      6
+
+// events fed to fsmDispatch()
+#define CLICK_A_EVENT        0
+#define DOUBLE_CLICK_A_EVENT 1
+#define LONG_PRESS_A_EVENT   2
+#define CLICK_B_EVENT        3
+#define DOUBLE_CLICK_B_EVENT 4
+#define LONG_PRESS_B_EVENT   5
+#define TIMEOUT_EVENT        6 // the state has been shown long enough
+#define ALARM_EVENT          7 // an alarm is due
+#define FSM_EVENTS           8
+
+// transition actions, indexes into fsmActions
+#define NO_ACTION            0
+#define NEXT_DIGIT_ACTION    1
+#define SKIP_DIGIT_ACTION    2
+#define INCREMENT_ACTION     3
+#define INCREMENT_2_ACTION   4
+#define SET_TIME_ACTION      5
+#define TOGGLE_ALARM_ACTION  6
+#define SET_ALARM_ACTION     7
+#define FSM_ACTIONS          8
+
+#define NO_STATE 255 // next state of a transition that stays put
 
 #define SHOW_TIME_DURATION 7000
 #define SHOW_TEMP_DURATION 3000
+#define SPLASH_DURATION    600 // mode name shown on entering the edit modes
 #define ONE_MINUTE         60000
 #define ONE_SECOND         1000
 
 // ---------------------- //
-//  Alarm song variables
+//  Power
 // ---------------------- //
-#define SONG_DURATION 64
+// loop() idles the CPU until the next interrupt (Timer0, the mux,
+// pin changes, Serial). Every DUTY_REPORT_PERIOD ms the share of time
+// spent awake in each FSM state is sent as telemetry; 0 disables the
+// report.
+#define DUTY_REPORT_PERIOD ONE_MINUTE
 
-int notePosition = 0;
+unsigned long awakeMicros[FSM_STATES];
+unsigned long asleepMicros[FSM_STATES];
+unsigned long lastWake       = 0;
+unsigned long lastDutyReport = 0;
 
-int melody[] = {1319, 0, 1319, 0, 1319, 0, 1319, 0, 1976, 0, 1976, 0, 1976,
- 0, 1976, 0, 1760, 0, 1760, 0, 1760, 0, 1760, 0, 1976, 0, 1976, 0, 1976, 0, 
- 1976, 0, 2349, 0, 2349, 0, 2349, 0, 2349, 0, 1760, 0, 1760, 0, 1760, 0,
-  1760, 0, 1760, 0, 1760, 0, 1760, 0, 1760, 0, 1760, 0, 1760, 0, 1760, 0,
-   1760, 0};
+// ---------------------- //
+//  Loop statistics
+// ---------------------- //
+// Per FSM state, log2 histograms of how long each loop() iteration is
+// awake and of the gap between two pollButtons() calls. Bucket 0 is
+// below 2 * LOOP_STATS_UNIT us, bucket i from LOOP_STATS_UNIT << i, the
+// last one is open ended. Send LOOP_STATS_CMD over Serial to dump and
+// clear them. Off by default, like _ISR_PROFILE.
+#ifndef LOOP_STATS
+#define LOOP_STATS 0
+#endif
+
+#if LOOP_STATS
+#define LOOP_STATS_BUCKETS 12
+#define LOOP_STATS_UNIT    16 // us
+
+unsigned int  loopHist[FSM_STATES][LOOP_STATS_BUCKETS];
+unsigned int  pollHist[FSM_STATES][LOOP_STATS_BUCKETS];
+unsigned long lastButtonPoll = 0;
+#endif
+
+// ---------------------- //
+//  Serial commands
+// ---------------------- //
+// single characters read from Serial in loop(), some followed by a
+// fixed number of argument characters. The alarm commands edit the
+// table entry last picked with ALARM_CMD, the wake alarm until then;
+// the buttons only ever edit the wake alarm. WEEKDAYS_CMD takes one
+// character per day, Sunday first, '-' for off:
+// "a1t0630w-MTWTF-re" rings alarm 1 at 06:30 on weekdays
+#define LOOP_STATS_CMD  'l' // loop statistics, with LOOP_STATS set
+#define ISR_PROFILE_CMD 'i' // mux ISR profile, with _ISR_PROFILE set
+#define BRIGHTER_CMD    '+' // one brightness step up, saved
+#define DIMMER_CMD      '-' // one brightness step down, saved
+#define ALARM_CMD       'a' // and its entry, 0 to MAX_ALARMS - 1: alarm to edit
+#define TIME_CMD        't' // and HHMM: alarm time, saved
+#define ON_CMD          'e' // alarm on, saved
+#define OFF_CMD         'd' // alarm off, saved
+#define WEEKDAYS_CMD    'w' // and seven days: alarm days, saved
+#define ONCE_CMD        'o' // alarm rings once, then turns off, saved
+#define REPEAT_CMD      'r' // alarm rings on every selected day, saved
+#define BRIGHTNESS_STEP 32  // one of the display's eight gamma steps
+
+byte commandCode;            // command reading its argument
+byte commandLeft = 0;        // argument characters still to come
+unsigned int commandArg;     // argument so far
+byte commandAlarm = 0;       // alarm table entry the alarm commands edit
 
-int noteDurations[] = {63, 42, 63, 42, 63, 42, 63, 42, 63, 42, 63, 42, 63,
- 42, 63, 42, 63, 42, 63, 42, 63, 42, 63, 42, 63, 42, 63, 42, 63, 42, 63, 42,
-  63, 42, 63, 42, 63, 42, 63, 42, 63, 42, 63, 42, 63, 42, 63, 42, 63, 42,
-   63, 42, 63, 42, 63, 42, 63, 42, 63, 42, 63, 42, 63, 42};
+// ---------------------- //
+//  Alarm song
+// ---------------------- //
+// Songs.h is compiled from Songs.rtttl, see host/tools/rtttl.cpp
+#define ALARM_SONG 0 // index into songs
 
 // ---------------------- //
 //  Common definitions
 // ---------------------- //
 #define N 4 // number of LCD digits
+#define WAKE_ALARM 0 // alarm table entry edited in EDIT_ALARM_MODE
+
+static_assert(MAX_ALARMS == SETTINGS_ALARMS, "every alarm table entry is saved");
 
 // ---------------------- //
 //  Globals
 // ---------------------- //
-byte oldFsmState    = 255;
 byte fsmState       = 0;
 byte activeDigit    = 0;
 byte digitValues[N] = {0,0,0,0};
 int  tempInCelsius  = 0;
 unsigned long updateInterval    = 100;
 unsigned long lastTempRead      = 0;
+unsigned long conversionStart   = 0;
+unsigned long conversionTime    = 750; // worst case for the sensor resolution
+bool          conversionPending = false;
+byte          tempLevel         = TEMP_LEVELS; // none set yet
+long          tempFilter        = 0;   // 0.01 C << TEMP_EMA_SHIFT
+bool          tempFilterValid   = false;
 unsigned long lastClockRead     = 0;
-unsigned long lastAlarmTrigger  = 0;
 unsigned long lastShowTimeStart = 0;
 unsigned long lastShowTempStart = 0;
 
-SevenSegController display(DIGIT0_PIN, DIGIT1_PIN, DIGIT2_PIN, DIGIT3_PIN, 
-	COLON_PIN, DEGREE_PIN, LATCH_PIN, DATA_PIN, CLOCK_PIN);
-OneButton buttonA(BUTTON_A_PIN, true);
-OneButton buttonB(BUTTON_B_PIN, true);
+volatile time_t        rtcSeconds     = 0; // advanced by the RTC tick ISR
+volatile time_t        rtcNextSeconds = 0; // loaded by the next tick instead, 0 for none
+volatile unsigned long lastTickMillis = 0;
+time_t                 lastRtcResync  = 0;
+
+// bit-banged transport: MOSI (11) drives DIGIT3 and XCK (4) is the
+// 1-Wire bus on this board, so neither SPI transport is available.
+SevenSegDisplay<SevenSegPins<COLON_PIN, DEGREE_PIN, LATCH_PIN, DATA_PIN, CLOCK_PIN,
+	DIGIT0_PIN, DIGIT1_PIN, DIGIT2_PIN, DIGIT3_PIN> > display;
+Button buttonA(BUTTON_A_PIN);
+Button buttonB(BUTTON_B_PIN);
+EdgeQueue buttonEdges;
+Telemetry telemetry(Serial);
+SettingsStore settingsStore;
+SongPlayer alarmPlayer;
 OneWire oneWire(ONE_WIRE_BUS);
 DallasTemperature sensor(&oneWire);
 DeviceAddress devAddr;
-Alarm wkAlarm;
+AlarmScheduler alarms;
 
 // ----------------------------- //
 //  RTC alarm functions
 // ----------------------------- //
-void enableRtcAlarm()
+void enableRtcAlarm(byte index)
 {
-	wkAlarm.enableAlarm();
-	printAlarmStatus();
+	alarms.enableAlarm(index);
+	reportAlarm(index);
 }
 
-void disableRtcAlarm()
+void disableRtcAlarm(byte index)
 {
-	wkAlarm.disableAlarm();
-	printAlarmStatus();
+	alarms.disableAlarm(index);
+	reportAlarm(index);
 }
 
-void setRtcAlarm(byte hour, byte minute)
+void setRtcAlarm(byte index, byte hour, byte minute)
 {	
 	// copy time_t object, modify some fields, 
 	// inherit month, day, dayOfWeek and Year.
@@ -124,41 +260,221 @@ void setRtcAlarm(byte hour, byte minute)
 	alarmSetting.Hour = hour;
 	alarmSetting.Minute = minute;
 	alarmSetting.Second = 0;
-	wkAlarm.setAlarmTime(makeTime(alarmSetting));
+	alarms.setAlarmTime(index, makeTime(alarmSetting));
+
+	reportAlarm(index);
+}
+
+void setRtcAlarmDays(byte index, byte weekdays)
+{
+	alarms.setWeekdays(index, weekdays);
+	reportAlarm(index);
+}
+
+void setRtcAlarmRepeat(byte index, bool repeat)
+{
+	alarms.setRepeat(index, repeat);
+	reportAlarm(index);
+}
 
-	printAlarmStatus();
+byte isRtcAlarmOn(byte index)
+{
+	return (byte) alarms.getAlarm(index).isEnabled();
 }
 
-void stopAlarmCallback()
+void startAlarmSong()
 {
-	oldFsmState = SHOW_ALARM_MODE;
-	fsmState    = SHOW_TIME_MODE;
-	disableRtcAlarm();
-	notePosition = 0;
-	lastAlarmTrigger = millis();
+	alarmPlayer.start((const byte *) pgm_read_ptr(&songs[ALARM_SONG]));
+	startAlarmNote();
 }
 
-byte isRtcAlarmOn()
+void startAlarmNote()
 {
-	return (byte) wkAlarm.isEnabled();
+	// the display goes dark while a note sounds and comes back
+	// during the rests, so it flashes along with the song
+	unsigned int frequency = alarmPlayer.frequency();
+	if (frequency)
+	{
+		// the colon goes dark with the digits
+		display.disableDisplay();
+		tone(BUZZER_PIN, frequency);
+	} else
+	{
+		noTone(BUZZER_PIN);
+		display.enableDisplay();
+	}
 }
 
 void playAlarmSong()
 {	
-	int noteDuration = noteDurations[notePosition];	
+	// never blocks: called every loop, only moves on once
+	// the current note has run for its duration
+	if (alarmPlayer.update(millis()))
+		startAlarmNote();
+}
+
+void stopAlarmSong()
+{
+	noTone(BUZZER_PIN);
+	display.enableDisplay();
+}
 
-	if (melody[notePosition])
+// ---------------------- //
+//  Thermometer
+// ---------------------- //
+void startTemperatureConversion()
+{
+	// returns right away, setWaitForConversion(false) is set in setup()
+	sensor.requestTemperatures();
+	conversionStart   = millis();
+	conversionPending = true;
+}
+
+void setTemperatureLevel(byte level)
+{
+	// levels may share a resolution, only talk to the sensor on a change
+	if (tempLevel == TEMP_LEVELS || tempResolution[level] != tempResolution[tempLevel])
 	{
-		tone(A2, melody[notePosition]);
-		delay(noteDuration);
-		noTone(A2);
-	} else
+		sensor.setResolution(devAddr, tempResolution[level], true);
+		conversionTime = sensor.millisToWaitForConversion(tempResolution[level]);
+	}
+	tempLevel = level;
+}
+
+void filterTemperature(int sample)
+{
+	if (!tempFilterValid)
+	{
+		tempFilter      = (long) sample << TEMP_EMA_SHIFT;
+		tempFilterValid = true;
+	}
+
+	int delta = sample - (int) (tempFilter >> TEMP_EMA_SHIFT);
+	tempFilter += sample - (tempFilter >> TEMP_EMA_SHIFT);
+
+	// sample faster and coarser while the temperature moves, slower
+	// and finer once it settles
+	if (abs(delta) >= TEMP_FAST_DELTA)
+		setTemperatureLevel(0);
+	else if (abs(delta) <= TEMP_SLOW_DELTA && tempLevel < TEMP_LEVELS - 1)
+		setTemperatureLevel(tempLevel + 1);
+
+	// round the 0.01 C filter output to the 0.1 C shown on the display
+	int filtered  = tempFilter >> TEMP_EMA_SHIFT;
+	tempInCelsius = (filtered + (filtered < 0 ? -5 : 5)) / 10;
+
+	telemetry.sendTemperature(sample, filtered, tempLevel);
+}
+
+void pollTemperature()
+{
+	if (!conversionPending)
+	{
+		// the next conversion is due once the level's interval is over
+		if ((millis() - conversionStart) >= tempInterval[tempLevel])
+			startTemperatureConversion();
+		return;
+	}
+
+	if ((millis() - conversionStart) < conversionTime)
+		return;
+
+	conversionPending = false;
+
+	float reading = sensor.getTempC(devAddr);
+	if (reading != DEVICE_DISCONNECTED_C)
+		filterTemperature((int) (reading * 100));
+}
+
+// ----------------------------- //
+//  RTC MFP functions
+// ----------------------------- //
+// shared by the MFP and the buttons, all on port C
+ISR(PCINT1_vect)
+{
+	static byte lastPins = 0xFF;
+	byte pins = PINC;
+	byte falling = lastPins & ~pins;
+	byte changed = lastPins ^ pins;
+	lastPins = pins;
+
+	if (changed & BUTTON_MASK)
+		buttonEdges.push(pins, millis());
+
+	if (falling & MFP_MASK)
+	{
+#if MFP_MODE == MFP_SQUARE_WAVE
+		// one falling edge per second, which starts the second a
+		// scheduled resync read the RTC ahead of
+		if (rtcNextSeconds)
+		{
+			rtcSeconds     = rtcNextSeconds;
+			rtcNextSeconds = 0;
+		} else
+			rtcSeconds++;
+		lastTickMillis = millis();
+#else
+		alarms.rtcInterrupt();
+#endif
+	}
+}
+
+time_t resyncRtcTick()
+{
+	time_t t = RTC.get();
+
+	if (t)
 	{
-		delay(noteDuration);	
+		noInterrupts();
+		rtcSeconds     = t;
+		rtcNextSeconds = 0;
+		lastTickMillis = millis();
+		interrupts();
+		lastRtcResync  = t;
 	}
-	notePosition++;
-	// roll over, once finished;
-	notePosition %= SONG_DURATION; 
+
+	return t;
+}
+
+// Resync while the MFP ticks: the time read now is loaded by the next
+// falling edge, plus the second it starts, so the count stays in phase
+// with the RTC. A tick during the I2C read leaves it unknown which
+// second was read; the resync is then tried again on the next call.
+void scheduleRtcResync()
+{
+	noInterrupts();
+	time_t before = rtcSeconds;
+	interrupts();
+	time_t t = RTC.get();
+
+	if (!t)
+		return;
+
+	noInterrupts();
+	if (rtcSeconds == before)
+	{
+		rtcNextSeconds = t + 1;
+		lastRtcResync  = t;
+	}
+	interrupts();
+}
+
+time_t rtcTickTime()
+{
+	// sync provider for the Time library, cheap while the RTC ticks
+	noInterrupts();
+	time_t t = rtcSeconds;
+	unsigned long lastTick = lastTickMillis;
+	interrupts();
+
+	// no ticks to keep in phase with, read the time right away
+	if ((millis() - lastTick) > RTC_TICK_TIMEOUT)
+		return resyncRtcTick();
+
+	if ((t - lastRtcResync) >= RTC_RESYNC_PERIOD)
+		scheduleRtcResync();
+
+	return t;
 }
 
 // ---------------------- //
@@ -177,13 +493,14 @@ void updateTime()
 
 	for (int i = 0; i < N; i++)
 		display.writeDigit(i, digitValues[i]);
+	display.commit();
 }
 
 void updateAlarm()
 {
-	time_t almTime = wkAlarm.getAlarmTime();
-	int h = hour(almTime);
-	int m = minute(almTime);
+	unsigned int almMinute = alarms.getAlarm(WAKE_ALARM).getMinuteOfDay();
+	int h = almMinute / 60;
+	int m = almMinute % 60;
 
 	digitValues[0] = h / 10;
 	digitValues[1] = h % 10;
@@ -192,18 +509,19 @@ void updateAlarm()
 
 	for (int i = 0; i < N; i++)
 		display.writeDigit(i, digitValues[i]);
+	display.commit();
 }
 
 void updateTemperature()
 {
-	sensor.requestTemperatures();
-	tempInCelsius  = (int) (sensor.getTempC(devAddr)*10);    
+	// shows the cached reading, the sensor is polled from loop()
 	digitValues[0] = tempInCelsius / 100;
 	digitValues[1] = (tempInCelsius % 100) / 10;
 	digitValues[2] = tempInCelsius % 10;
 
 	for (int i = 0; i < N-1; i++)
 		display.writeDigit(i, digitValues[i]);
+	display.commit();
 }
 
 int maxValueForDigit(int digit)
@@ -247,136 +565,364 @@ int maxValueForDigit(int digit)
 // ---------------------- //
 //  Button callbacks
 // ---------------------- //
-void implClickA(int value)
+void singleClickA()
 {
-	switch (fsmState)
-	{
-		case EDIT_TIME_MODE:
-		case EDIT_ALARM_MODE:
-			display.disableBlink(activeDigit);
-			activeDigit += value;
-			activeDigit %= N;
-			display.enableBlink(activeDigit);
-			break;
-
-		case SHOW_ALARM_MODE:
-			stopAlarmCallback();
-			break;
-	}
+	fsmDispatch(CLICK_A_EVENT);
 }
 
 void doubleClickA()
 {
-	implClickA(2);
+	fsmDispatch(DOUBLE_CLICK_A_EVENT);
 }
 
-void singleClickA()
+void longPressA()
 {
-	implClickA(1);
+	fsmDispatch(LONG_PRESS_A_EVENT);
 }
 
-void longPressA()
+void singleClickB()
 {
-	switch(fsmState)
-	{
-		case EDIT_TIME_MODE:
-			int h;
-			int m;
-			h = digitValues[0]*10 + digitValues[1];
-			m = digitValues[2]*10 + digitValues[3];
-			setTime(h, m, 0, 1, 1, 2016);
-			RTC.set(now());
-			fsmState = SHOW_TIME_MODE;
-			break;
+	fsmDispatch(CLICK_B_EVENT);
+}
 
-		case EDIT_ALARM_MODE:
-			if (isRtcAlarmOn())
-			{
-				disableRtcAlarm();
-				for (int i = 0; i < N; i++)
-					display.disableDecimalPoint(i);
-			} else 
-			{
-				enableRtcAlarm();
-				for (int i = 0; i < N; i++)
-					display.enableDecimalPoint(i);
-			}
-			break;
+void doubleClickB()
+{
+	fsmDispatch(DOUBLE_CLICK_B_EVENT);
+}
 
-		case SHOW_TIME_MODE:
-		case SHOW_TEMP_MODE:
-			fsmState = EDIT_TIME_MODE;
-			break;
+void longPressB()
+{
+	fsmDispatch(LONG_PRESS_B_EVENT);
+}
+
+// ---------------------- //
+//  FSM state hooks
+// ---------------------- //
+void enterEditTime()
+{
+	display.showMessageFor("hora", SPLASH_DURATION);
+	display.enableClockDisplay();
+	activeDigit = 0;
+	display.enableBlink(activeDigit);
+	// commits the mode together with the digits
+	updateTime();
+}
+
+void enterEditAlarm()
+{
+	display.showMessageFor("alarme", SPLASH_DURATION);
+	display.enableClockDisplay();
 
+	if (isRtcAlarmOn(WAKE_ALARM))
+	{
+		for (int i = 0; i < N; i++)
+			display.enableDecimalPoint(i);
+	} else {
+		for (int i = 0; i < N; i++)
+			display.disableDecimalPoint(i);
+	}
 
-		case SHOW_ALARM_MODE:
-			stopAlarmCallback();
-			break;
+	activeDigit = 0;
+	display.enableBlink(activeDigit);
+	updateAlarm();
+}
+
+void enterShowTime()
+{
+	display.enableClockDisplay();
+	updateTime();
+	lastClockRead = millis();
+	lastShowTimeStart = lastClockRead;
+}
+
+void runShowTime()
+{
+	if ((millis() - lastClockRead) > updateInterval)
+	{
+		updateTime();
+		lastClockRead = millis();
 	}
+
+	if ((millis() - lastShowTimeStart) > SHOW_TIME_DURATION)
+		fsmDispatch(TIMEOUT_EVENT);
+}
+
+void enterShowTemp()
+{
+	display.enableTempDisplay();
+	updateTemperature();
+	lastTempRead = millis();
+	lastShowTempStart = lastTempRead;
 }
 
-void implClickB(int value)
+void runShowTemp()
 {
-	switch (fsmState)
+	if ((millis() - lastTempRead) > updateInterval)
 	{
-		case EDIT_TIME_MODE:
-		case EDIT_ALARM_MODE:
-			digitValues[activeDigit] += value;
-			digitValues[activeDigit] %= maxValueForDigit(activeDigit);
-			display.writeDigit(activeDigit, digitValues[activeDigit]);
-			break;
+		updateTemperature();
+		lastTempRead = millis();
+	}
 
-		case SHOW_ALARM_MODE:
-			stopAlarmCallback();
-			break;
+	if ((millis() - lastShowTempStart) > SHOW_TEMP_DURATION)
+		fsmDispatch(TIMEOUT_EVENT);
+}
+
+void enterShowAlarm()
+{
+	// update the time, so the display is not stuck in garbage.
+	display.enableClockDisplay();
+	updateTime();
+	startAlarmSong();
+
+	reportTime();
+	reportAlarm(alarms.getTriggeredAlarm());
+
+	// a one-shot alarm has just switched itself off
+	saveSettings();
+}
+
+void enterError()
+{
+	display.scrollMessage("ERRO rtc");
+	telemetry.sendStatus(TELEMETRY_STATUS_ERROR);
+	for (byte i = 0; i < MAX_ALARMS; i++)
+	{
+		if (isRtcAlarmOn(i))
+			disableRtcAlarm(i);
 	}
 }
 
-void doubleClickB()
+// ---------------------- //
+//  FSM actions
+// ---------------------- //
+void moveActiveDigit(byte step)
 {
-	implClickB(2);
+	display.disableBlink(activeDigit);
+	activeDigit += step;
+	activeDigit %= N;
+	display.enableBlink(activeDigit);
+	display.commit();
 }
 
-void singleClickB()
+void incrementActiveDigit(byte step)
 {
-	implClickB(1);
+	digitValues[activeDigit] += step;
+	digitValues[activeDigit] %= maxValueForDigit(activeDigit);
+	display.writeDigit(activeDigit, digitValues[activeDigit]);
+	display.commit();
 }
 
-void longPressB()
+void nextDigit()
+{
+	moveActiveDigit(1);
+}
+
+void skipDigit()
+{
+	moveActiveDigit(2);
+}
+
+void incrementDigit()
+{
+	incrementActiveDigit(1);
+}
+
+void incrementDigitTwice()
+{
+	incrementActiveDigit(2);
+}
+
+void commitTime()
 {
-	switch(fsmState)
+	int h = digitValues[0]*10 + digitValues[1];
+	int m = digitValues[2]*10 + digitValues[3];
+	setTime(h, m, 0, 1, 1, 2016);
+	RTC.set(now());
+	alarms.reschedule(now());
+#if MFP_MODE == MFP_SQUARE_WAVE
+	resyncRtcTick();
+#endif
+}
+
+void toggleAlarm()
+{
+	if (isRtcAlarmOn(WAKE_ALARM))
 	{
-		case EDIT_ALARM_MODE:
-			byte h, m;
-			h = digitValues[0]*10 + digitValues[1];
-			m = digitValues[2]*10 + digitValues[3];
-			setRtcAlarm(h,m);
-			fsmState = SHOW_TIME_MODE;
-			break;
+		disableRtcAlarm(WAKE_ALARM);
+		for (int i = 0; i < N; i++)
+			display.disableDecimalPoint(i);
+	} else
+	{
+		enableRtcAlarm(WAKE_ALARM);
+		for (int i = 0; i < N; i++)
+			display.enableDecimalPoint(i);
+	}
+	display.commit();
+	saveSettings();
+}
 
-		case SHOW_TIME_MODE:
-		case SHOW_TEMP_MODE:
-			fsmState = EDIT_ALARM_MODE;
-			break;
+void commitAlarm()
+{
+	byte h = digitValues[0]*10 + digitValues[1];
+	byte m = digitValues[2]*10 + digitValues[3];
+	setRtcAlarm(WAKE_ALARM, h, m);
+	saveSettings();
+}
 
-		case SHOW_ALARM_MODE:
-			stopAlarmCallback();
-			break;
+// ---------------------- //
+//  FSM tables
+// ---------------------- //
+// Both tables live in flash. A transition runs the exit hook of the
+// current state, then its action, then the entry hook of the next
+// state; with NO_STATE only the action runs. The run hook is called
+// once per loop() iteration.
+typedef void (*FsmFunction)();
+
+struct FsmStateHooks
+{
+	FsmFunction enter;
+	FsmFunction run;
+	FsmFunction exit;
+};
+
+struct FsmTransition
+{
+	byte action;
+	byte next;
+};
+
+const FsmStateHooks fsmStates[FSM_STATES] PROGMEM = {
+	{enterEditTime,  NULL,          NULL},          // EDIT_TIME_MODE
+	{enterEditAlarm, NULL,          NULL},          // EDIT_ALARM_MODE
+	{enterShowTime,  runShowTime,   NULL},          // SHOW_TIME_MODE
+	{enterShowTemp,  runShowTemp,   NULL},          // SHOW_TEMP_MODE
+	{enterShowAlarm, playAlarmSong, stopAlarmSong}, // SHOW_ALARM_MODE
+	{enterError,     NULL,          NULL},          // ERROR_MODE
+};
+
+const FsmFunction fsmActions[FSM_ACTIONS] PROGMEM = {
+	NULL,                // NO_ACTION
+	nextDigit,           // NEXT_DIGIT_ACTION
+	skipDigit,           // SKIP_DIGIT_ACTION
+	incrementDigit,      // INCREMENT_ACTION
+	incrementDigitTwice, // INCREMENT_2_ACTION
+	commitTime,          // SET_TIME_ACTION
+	toggleAlarm,         // TOGGLE_ALARM_ACTION
+	commitAlarm,         // SET_ALARM_ACTION
+};
+
+#define IGNORE        {NO_ACTION, NO_STATE}
+#define DO(action)    {action, NO_STATE}
+#define GOTO(state)   {NO_ACTION, state}
+
+// one row per state, one column per event:
+// click A, double click A, long press A, click B, double click B,
+// long press B, timeout, alarm
+const FsmTransition fsmTable[FSM_STATES][FSM_EVENTS] PROGMEM = {
+	{	// EDIT_TIME_MODE
+		DO(NEXT_DIGIT_ACTION), DO(SKIP_DIGIT_ACTION), {SET_TIME_ACTION, SHOW_TIME_MODE},
+		DO(INCREMENT_ACTION), DO(INCREMENT_2_ACTION), IGNORE,
+		IGNORE, IGNORE
+	},
+	{	// EDIT_ALARM_MODE
+		DO(NEXT_DIGIT_ACTION), DO(SKIP_DIGIT_ACTION), DO(TOGGLE_ALARM_ACTION),
+		DO(INCREMENT_ACTION), DO(INCREMENT_2_ACTION), {SET_ALARM_ACTION, SHOW_TIME_MODE},
+		IGNORE, IGNORE
+	},
+	{	// SHOW_TIME_MODE
+		IGNORE, IGNORE, GOTO(EDIT_TIME_MODE),
+		IGNORE, IGNORE, GOTO(EDIT_ALARM_MODE),
+		GOTO(SHOW_TEMP_MODE), GOTO(SHOW_ALARM_MODE)
+	},
+	{	// SHOW_TEMP_MODE
+		IGNORE, IGNORE, GOTO(EDIT_TIME_MODE),
+		IGNORE, IGNORE, GOTO(EDIT_ALARM_MODE),
+		GOTO(SHOW_TIME_MODE), GOTO(SHOW_ALARM_MODE)
+	},
+	{	// SHOW_ALARM_MODE, any button stops the song
+		GOTO(SHOW_TIME_MODE), GOTO(SHOW_TIME_MODE), GOTO(SHOW_TIME_MODE),
+		GOTO(SHOW_TIME_MODE), GOTO(SHOW_TIME_MODE), GOTO(SHOW_TIME_MODE),
+		IGNORE, IGNORE
+	},
+	{	// ERROR_MODE, buttons are not even polled
+		IGNORE, IGNORE, IGNORE,
+		IGNORE, IGNORE, IGNORE,
+		IGNORE, IGNORE
+	},
+};
+
+// ---------------------- //
+//  FSM engine
+// ---------------------- //
+void fsmCall(const FsmFunction *hook)
+{
+	FsmFunction f = (FsmFunction) pgm_read_ptr(hook);
+	if (f)
+		f();
+}
+
+void fsmStart(byte state)
+{
+	fsmState = state;
+	fsmCall(&fsmStates[state].enter);
+}
+
+bool fsmHandles(byte event)
+{
+	const FsmTransition *t = &fsmTable[fsmState][event];
+	return pgm_read_byte(&t->action) != NO_ACTION || pgm_read_byte(&t->next) != NO_STATE;
+}
+
+void fsmDispatch(byte event)
+{
+	const FsmTransition *t = &fsmTable[fsmState][event];
+	byte action = pgm_read_byte(&t->action);
+	byte next   = pgm_read_byte(&t->next);
+
+	if (action == NO_ACTION && next == NO_STATE)
+		return;
+
+	// every dispatch is reported, with the time its exit hook, action
+	// and entry hook took
+	byte from = fsmState;
+	unsigned long start = micros();
+
+	if (next != NO_STATE)
+		fsmCall(&fsmStates[fsmState].exit);
+
+	fsmCall(&fsmActions[action]);
+
+	if (next != NO_STATE)
+	{
+		fsmState = next;
+		fsmCall(&fsmStates[next].enter);
 	}
+
+	unsigned long us = micros() - start;
+	telemetry.sendTransition(from, event, fsmState, min(us, 0xFFFFUL));
+}
+
+void fsmRun()
+{
+	fsmCall(&fsmStates[fsmState].run);
 }
 
 void setup()
 {
-	fsmState = EDIT_TIME_MODE;
+	byte initialState = EDIT_TIME_MODE;
 
 	// initialize thermometer
 	sensor.begin();
-	sensor.setWaitForConversion(true);
+	sensor.setWaitForConversion(false);
+	// the resolution changes at run time, keep it out of the sensor's EEPROM
+	sensor.setAutoSaveScratchPad(false);
 	sensor.getAddress(devAddr, 0);
-	sensor.requestTemperatures();
-	tempInCelsius = (int) (sensor.getTempC(devAddr)*10);
+	setTemperatureLevel(0);
+	startTemperatureConversion();
 
-	// initialize buttons
+	// initialize buttons, edges come from PCINT8 and PCINT9
+	PCMSK1 |= _BV(PCINT8) | _BV(PCINT9);
+	PCICR  |= _BV(PCIE1);
 	buttonA.setClickTicks(250);
 	buttonA.setPressTicks(600);
 	buttonA.attachLongPressStart(longPressA);
@@ -392,21 +938,45 @@ void setup()
 	// initialize serial
 	Serial.begin(115200);
 
-	// initialize rtc
-	
+	// initialize rtc, the MFP is open drain
+	pinMode(ALARM_PIN, INPUT_PULLUP);
+	PCMSK1 |= _BV(PCINT11);
+	PCICR  |= _BV(PCIE1);
+#if MFP_MODE == MFP_SQUARE_WAVE
+	RTC.squareWave(SQWAVE_1_HZ);
+	resyncRtcTick();
+	setSyncProvider(rtcTickTime);
+#else
+	RTC.squareWave(SQWAVE_NONE);
+	RTC.alarmPolarity(LOW);
 	setSyncProvider(RTC.get);
+#endif
 	setSyncInterval(1);
 	if(timeStatus()!= timeSet) 
 	{
-		Serial.println("Unable to sync with the RTC");
-		fsmState = ERROR_MODE;
+		telemetry.sendStatus(TELEMETRY_STATUS_RTC_FAILED);
+		initialState = ERROR_MODE;
 	} else
 	{
-		Serial.println("RTC has set the system time"); 
+		telemetry.sendStatus(TELEMETRY_STATUS_RTC_SYNCED);
 	}
-	
-	// default alarm settings, 08:30, disabled
-	pinMode(ALARM_PIN, INPUT_PULLUP);
+	loadSettings();
+
+#if MFP_MODE == MFP_ALARM
+	// needs the synced time to program the first match
+	alarms.useRtcAlarm(ALARM_0);
+#endif
+
+	// the mux ISR has been running since the display was constructed,
+	// so its worst-case cost is known by now; let the display validate
+	// the refresh rate against it.
+	display.setRefreshRate(DISPLAY_REFRESH_RATE);
+
+#if LOOP_STATS
+	// the first poll interval starts here, not at boot
+	lastButtonPoll = micros();
+#endif
+	fsmStart(initialState);
 }
 
 void loop()
@@ -414,204 +984,400 @@ void loop()
 	// If error detected, disable buttons.
 	if (fsmState != ERROR_MODE)
 	{
-		buttonA.tick();
-		buttonB.tick();
+#if LOOP_STATS
+		recordButtonPoll();
+#endif
+		pollButtons();
 	}
 
-	// If alarm condition is detected, modify FSM state accordingly
-	// Alarm is just triggered outside the edit modes.
-	if (wkAlarm.isTriggered(now()) && fsmState != EDIT_ALARM_MODE 
-		&& fsmState != EDIT_TIME_MODE && fsmState != SHOW_ALARM_MODE)
+#if _ISR_PROFILE
+	display.drainIsrProfile();
+#endif
+	pollSerialCommands();
+	telemetry.drain();
+	settingsStore.poll();
+
+	pollTemperature();
+
+	// Alarms are only asked for in the states that take them, as each
+	// one fires once per selected day.
+	if (fsmHandles(ALARM_EVENT) && alarms.isTriggered(now()))
+		fsmDispatch(ALARM_EVENT);
+
+	fsmRun();
+
+	if (DUTY_REPORT_PERIOD && (millis() - lastDutyReport) > DUTY_REPORT_PERIOD)
 	{
-		oldFsmState = fsmState;
-		// update the time, so the display is not stuck in garbage.
-		updateTime();
-		display.enableClockDisplay();
-		fsmState = SHOW_ALARM_MODE;
+		sendDutyCycle();
+		lastDutyReport = millis();
+	}
 
-		digitalClockDisplay();
-		printAlarmStatus();
+	// nothing is left to do until the next interrupt
+	sleepUntilInterrupt();
+}
+
+// -------------------------------------- //
+//  Button functions
+// -------------------------------------- //
+void pollButtons()
+{
+	// Every edge queued before this point happened by now, and every
+	// later one at or after it, so the timeouts below never overtake
+	// an edge still in the queue.
+	noInterrupts();
+	unsigned long now = millis();
+	byte end  = buttonEdges.head();
+	bool lost = buttonEdges.overflowed();
+	interrupts();
+
+	Edge edge;
+	while (buttonEdges.pop(edge, end))
+	{
+		buttonA.edge(edge.pins, edge.time);
+		buttonB.edge(edge.pins, edge.time);
 	}
 
-	// After an alarm is cleared by the user, wait for a minute
-	// and re-enable the alarm to provide for repeatable alarms
-	// everyday without user intervention.
-	if ((millis() - lastAlarmTrigger) > ONE_MINUTE && lastAlarmTrigger)
+	// some edges were dropped, carry on from the pins as they are
+	if (lost)
 	{
-		enableRtcAlarm();
-		lastAlarmTrigger = 0;
+		byte pins = PINC;
+		buttonA.edge(pins, now);
+		buttonB.edge(pins, now);
 	}
 
+	buttonA.tick(now);
+	buttonB.tick(now);
+}
+
+// -------------------------------------- //
+//  Power functions
+// -------------------------------------- //
+void sleepUntilInterrupt()
+{
+	unsigned long sleepStart = micros();
+	awakeMicros[fsmState] += sleepStart - lastWake;
+#if LOOP_STATS
+	recordLatency(loopHist[fsmState], sleepStart - lastWake);
+#endif
+
+	// IDLE keeps Timer0 running, which millis(), the button timings and the FSM
+	// timeouts rely on; the deeper modes would stop it.
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_enable();
+	sleep_cpu();
+	sleep_disable();
+
+	// the ISRs that ran in between are booked as asleep
+	lastWake = micros();
+	asleepMicros[fsmState] += lastWake - sleepStart;
+}
+
+void sendDutyCycle()
+{
+	for (byte state = 0; state < FSM_STATES; state++)
+	{
+		unsigned long total = awakeMicros[state] + asleepMicros[state];
+		if (!total)
+			continue;
+
+		// awake share in 0.1 %, scaled down first so it fits 32 bits
+		unsigned long permille = (awakeMicros[state] / 16) * 1000 / (total / 16 + 1);
+
+		telemetry.sendDuty(state, permille, min(total / 1000, 0xFFFFUL));
+
+		awakeMicros[state]  = 0;
+		asleepMicros[state] = 0;
+	}
+}
 
-	switch (fsmState)
+// -------------------------------------- //
+//  Loop statistics functions
+// -------------------------------------- //
+#if LOOP_STATS
+void recordLatency(unsigned int *hist, unsigned long us)
+{
+	byte bucket = 0;
+	us /= LOOP_STATS_UNIT;
+	while (us > 1 && bucket < LOOP_STATS_BUCKETS - 1)
 	{
-		case EDIT_TIME_MODE:
+		us >>= 1;
+		bucket++;
+	}
 
-			if (oldFsmState != fsmState)
-			{
-				display.enableNumericDisplay();
-				display.writeMessage("hora");
-				delay(600);
-				updateTime();
-				display.enableClockDisplay();
-				activeDigit = 0;
-				display.enableBlink(activeDigit);
-			}
+	// halve the whole histogram instead of wrapping, keeps its shape
+	if (hist[bucket] == 0xFFFF)
+	{
+		for (byte i = 0; i < LOOP_STATS_BUCKETS; i++)
+			hist[i] >>= 1;
+	}
+	hist[bucket]++;
+}
 
-			oldFsmState = fsmState;
+void recordButtonPoll()
+{
+	unsigned long t = micros();
+	recordLatency(pollHist[fsmState], t - lastButtonPoll);
+	lastButtonPoll = t;
+}
+
+void printLoopStats()
+{
+	Serial.print("loop stats, log2 buckets from ");
+	Serial.print(LOOP_STATS_UNIT);
+	Serial.println(" us");
+
+	for (byte state = 0; state < FSM_STATES; state++)
+	{
+		printHistogram(" loop", state, loopHist[state]);
+		printHistogram(" poll", state, pollHist[state]);
+	}
+}
+
+void printHistogram(const char *name, byte state, unsigned int *hist)
+{
+	unsigned long total = 0;
+	for (byte i = 0; i < LOOP_STATS_BUCKETS; i++)
+		total += hist[i];
+	if (!total)
+		return;
+
+	Serial.print("state ");
+	Serial.print(state);
+	Serial.print(name);
+	for (byte i = 0; i < LOOP_STATS_BUCKETS; i++)
+	{
+		Serial.print(' ');
+		Serial.print(hist[i]);
+		hist[i] = 0;
+	}
+	Serial.println();
+}
+#endif
+
+// -------------------------------------- //
+//  Serial command functions
+// -------------------------------------- //
+void pollSerialCommands()
+{
+	if (!Serial.available())
+		return;
+
+	int c = Serial.read();
+
+	if (commandLeft)
+	{
+		// a line cut short leaves everything as it was
+		if (c == '\n' || c == '\r')
+		{
+			commandLeft = 0;
+			return;
+		}
+
+		if (commandCode == WEEKDAYS_CMD)
+		{
+			if (c != '-')
+				commandArg |= 1 << (DAYS_PER_WEEK - commandLeft);
+		} else if (c >= '0' && c <= '9')
+		{
+			commandArg = commandArg * 10 + (c - '0');
+		} else
+		{
+			commandLeft = 0;
+			return;
+		}
+
+		if (!--commandLeft)
+			runArgumentCommand();
+		return;
+	}
+
+	switch (c)
+	{
+#if LOOP_STATS
+		case LOOP_STATS_CMD:
+			printLoopStats();
 			break;
+#endif
 
-		case EDIT_ALARM_MODE:
-			
-			if (oldFsmState != fsmState)
-			{
-				display.enableNumericDisplay();
-				display.writeMessage("alarme");
-				delay(600);
-				updateAlarm();
-				display.enableClockDisplay();
-
-				if (isRtcAlarmOn())
-				{
-					for (int i = 0; i < N; i++)
-						display.enableDecimalPoint(i);
-				} else {
-					for (int i = 0; i < N; i++)
-						display.disableDecimalPoint(i);
-				}
-
-				activeDigit = 0;
-				display.enableBlink(activeDigit);
-			}
+#if _ISR_PROFILE
+		case ISR_PROFILE_CMD:
+			printIsrProfile();
+			break;
+#endif
 
-			oldFsmState = fsmState;
+		case BRIGHTER_CMD:
+			changeBrightness(BRIGHTNESS_STEP);
 			break;
 
-		case SHOW_TIME_MODE:
+		case DIMMER_CMD:
+			changeBrightness(-BRIGHTNESS_STEP);
+			break;
 
-			if (oldFsmState != fsmState)
-			{
-				updateTime();
-				lastClockRead = millis();
-				lastShowTimeStart = lastClockRead;
-				display.enableClockDisplay();
-			}
+		case ALARM_CMD:
+			readArgument(c, 1);
+			break;
 
-			oldFsmState = fsmState;
+		case TIME_CMD:
+			readArgument(c, 4);
+			break;
 
-			if ((millis() - lastClockRead) > updateInterval)
-			{
-				updateTime();
-				lastClockRead = millis();
-			}
+		case WEEKDAYS_CMD:
+			readArgument(c, DAYS_PER_WEEK);
+			break;
 
-			if ((millis() - lastShowTimeStart) > SHOW_TIME_DURATION)
-			{
-				fsmState = SHOW_TEMP_MODE;
-			}
+		case ON_CMD:
+			enableRtcAlarm(commandAlarm);
+			saveSettings();
+			break;
 
+		case OFF_CMD:
+			disableRtcAlarm(commandAlarm);
+			saveSettings();
 			break;
 
-		case SHOW_TEMP_MODE:
-			
-			if (oldFsmState != fsmState)
-			{
-				updateTemperature();
-				lastTempRead = millis();
-				lastShowTempStart = lastTempRead;
-				display.enableTempDisplay();
-			}
+		case ONCE_CMD:
+		case REPEAT_CMD:
+			setRtcAlarmRepeat(commandAlarm, c == REPEAT_CMD);
+			saveSettings();
+			break;
+	}
+}
 
-			oldFsmState = fsmState;
+void readArgument(byte code, byte length)
+{
+	commandCode = code;
+	commandLeft = length;
+	commandArg  = 0;
+}
 
-			if ((millis() - lastTempRead) > updateInterval)
+void runArgumentCommand()
+{
+	switch (commandCode)
+	{
+		case ALARM_CMD:
+			if (commandArg < MAX_ALARMS)
 			{
-				updateTemperature();
-				lastTempRead = millis();
+				commandAlarm = commandArg;
+				reportAlarm(commandAlarm);
 			}
+			break;
 
-			if ((millis() - lastShowTempStart) > SHOW_TEMP_DURATION)
+		case TIME_CMD:
+			if (commandArg / 100 < 24 && commandArg % 100 < 60)
 			{
-				fsmState = SHOW_TIME_MODE;
+				setRtcAlarm(commandAlarm, commandArg / 100, commandArg % 100);
+				saveSettings();
 			}
-
-			break;
-
-		case SHOW_ALARM_MODE:
-			display.disableDisplay();
-			display.disableColon();
-			playAlarmSong();
-			display.enableColon();
-			display.enableDisplay();
 			break;
 
-		case ERROR_MODE:
-			if (oldFsmState != fsmState)
-			{	
-				display.enableNumericDisplay();
-				display.writeMessage("ERRO");
-				Serial.println("Error detected, disabling buttons.");
-				Serial.println("Error detected, disabling RTC alarm.");
-				disableRtcAlarm();
-			}
+		case WEEKDAYS_CMD:
+			setRtcAlarmDays(commandAlarm, commandArg);
+			saveSettings();
 			break;
 	}
 }
 
+#if _ISR_PROFILE
+void printIsrProfile()
+{
+	IsrProfile profile;
+	display.getIsrProfile(profile);
+
+	Serial.print("mux isr, cycles: runs ");
+	Serial.print(profile.runs);
+	Serial.print(" lost ");
+	Serial.print(profile.lost);
+	Serial.print(" exec ");
+	Serial.print(profile.execMin);
+	Serial.print('/');
+	Serial.print(profile.execMean);
+	Serial.print('/');
+	Serial.print(profile.execMax);
+	Serial.print(" latency ");
+	Serial.print(profile.latencyMin);
+	Serial.print('-');
+	Serial.print(profile.latencyMax);
+	Serial.print(" jitter ");
+	Serial.println(profile.jitterMax);
+}
+#endif
+
 // -------------------------------------- //
-//  Debug helper functions
+//  Telemetry functions
 // -------------------------------------- //
-void printDigits(int digits, char separator)
+void reportTime()
 {
-	// Utility function for digital clock display: prints preceding 
-	// separator and leading 0
-	Serial.print(separator);
-	if(digits < 10)
-		Serial.print('0');
-	Serial.print(digits);
+	telemetry.sendTime(now(), timeStatus());
 }
 
-void digitalClockDisplay()
+void reportAlarm(byte index)
 {
-	time_t t = now();
-	printDigits(hour(t)  ,' ');
-	printDigits(minute(t),':');
-	printDigits(second(t),':');
-	Serial.print(" ");
-	Serial.print(day(t));
-	Serial.print(" ");
-	Serial.print(month(t));
-	Serial.print(" ");
-	Serial.print(year(t)); 
-	Serial.println(); 
-}
-
-void rtcStatus()
-{
-	timeStatus_t rtcSta = timeStatus();
-  
-	if(rtcSta == timeSet)
-		Serial.println("Time's clock has been set.");
-	else if (rtcSta == timeNotSet)
-		Serial.println("Time's clock has not been set.");
-	else if (rtcSta == timeNeedsSync)
-		Serial.println("Time's clock is set, but the sync has failed.");
-	else
-		Serial.println("error");
-}
-
-void printAlarmStatus()
-{
-	time_t almSet = wkAlarm.getAlarmTime();
-	byte h, m, rtcOn;
-	h = hour(almSet);
-	m = minute(almSet);
-	printDigits(h,' ');
-	printDigits(m,':');
-	rtcOn = isRtcAlarmOn();
-	if (rtcOn)
-		Serial.println(" -- ON");
-	else
-		Serial.println(" -- OFF");
+	const Alarm &alarm = alarms.getAlarm(index);
+	unsigned int almMinute = alarm.getMinuteOfDay();
+
+	byte flags = 0;
+	if (alarm.isEnabled())
+		flags |= TELEMETRY_ALARM_ON;
+	if (alarm.isRepeating())
+		flags |= TELEMETRY_ALARM_REPEAT;
 
+	telemetry.sendAlarm(index, almMinute / 60, almMinute % 60, flags,
+		alarm.getWeekdays());
+}
+
+// -------------------------------------- //
+//  Settings functions
+// -------------------------------------- //
+void loadSettings()
+{
+	Settings settings;
+	if (!settingsStore.load(settings))
+		return;
+
+	display.setBrightness(settings.brightness);
+
+	// placing the alarms needs the synced time
+	if (timeStatus() == timeNotSet)
+		return;
+
+	for (byte i = 0; i < MAX_ALARMS; i++)
+	{
+		const AlarmSettings &alarm = settings.alarms[i];
+
+		alarms.setWeekdays(i, alarm.weekdays);
+		alarms.setRepeat(i, alarm.hour & SETTINGS_ALARM_REPEAT);
+		if (alarm.hour & SETTINGS_ALARM_ON)
+			alarms.enableAlarm(i);
+		// places it for the time set, and reports the whole entry
+		setRtcAlarm(i, alarm.hour & SETTINGS_ALARM_HOUR, alarm.minute);
+	}
+}
+
+void saveSettings()
+{
+	Settings settings;
+
+	for (byte i = 0; i < MAX_ALARMS; i++)
+	{
+		const Alarm &alarm = alarms.getAlarm(i);
+		unsigned int almMinute = alarm.getMinuteOfDay();
+
+		settings.alarms[i].hour     = almMinute / 60;
+		settings.alarms[i].minute   = almMinute % 60;
+		settings.alarms[i].weekdays = alarm.getWeekdays();
+
+		if (alarm.isEnabled())
+			settings.alarms[i].hour |= SETTINGS_ALARM_ON;
+		if (alarm.isRepeating())
+			settings.alarms[i].hour |= SETTINGS_ALARM_REPEAT;
+	}
+	settings.brightness = display.getBrightness();
+
+	settingsStore.save(settings);
+}
+
+void changeBrightness(int step)
+{
+	display.setBrightness(constrain(display.getBrightness() + step, 0, 255));
+	saveSettings();
 }
\ No newline at end of file
@@ -2,12 +2,21 @@
 #define MEX_CLK_H
 
 // Alarm functions
-void enableRtcAlarm();
-void disableRtcAlarm();
-void setRtcAlarm(byte hour, byte minute);
-void stopAlarmCallback();
-byte isRtcAlarmOn();
+void enableRtcAlarm(byte index);
+void disableRtcAlarm(byte index);
+void setRtcAlarm(byte index, byte hour, byte minute);
+void setRtcAlarmDays(byte index, byte weekdays);
+void setRtcAlarmRepeat(byte index, bool repeat);
+byte isRtcAlarmOn(byte index);
+void startAlarmSong();
+void startAlarmNote();
 void playAlarmSong();
+void stopAlarmSong();
+
+// RTC tick functions
+time_t resyncRtcTick();
+void scheduleRtcResync();
+time_t rtcTickTime();
 
 // Display functions
 void updateTime();
@@ -15,20 +24,73 @@ void updateAlarm();
 void updateTemperature();
 int maxValueForDigit(int digit);
 
+// Thermometer functions
+void startTemperatureConversion();
+void setTemperatureLevel(byte level);
+void filterTemperature(int sample);
+void pollTemperature();
+
 // User IO functions
-void implClickA(int value);
-void doubleClickA();
 void singleClickA();
+void doubleClickA();
 void longPressA();
-void implClickB(int value);
-void doubleClickB();
 void singleClickB();
+void doubleClickB();
 void longPressB();
 
-// debug functions
-void printDigits(int digits, char separator);
-void digitalClockDisplay();
-void rtcStatus();
-void printAlarmStatus();
+// FSM state hooks
+void enterEditTime();
+void enterEditAlarm();
+void enterShowTime();
+void runShowTime();
+void enterShowTemp();
+void runShowTemp();
+void enterShowAlarm();
+void enterError();
+
+// FSM actions
+void moveActiveDigit(byte step);
+void incrementActiveDigit(byte step);
+void nextDigit();
+void skipDigit();
+void incrementDigit();
+void incrementDigitTwice();
+void commitTime();
+void toggleAlarm();
+void commitAlarm();
+
+// FSM engine
+void fsmStart(byte state);
+bool fsmHandles(byte event);
+void fsmDispatch(byte event);
+void fsmRun();
+
+// Button functions
+void pollButtons();
+
+// Power functions
+void sleepUntilInterrupt();
+void sendDutyCycle();
+
+// Loop statistics functions
+void recordLatency(unsigned int *hist, unsigned long us);
+void recordButtonPoll();
+void printLoopStats();
+void printHistogram(const char *name, byte state, unsigned int *hist);
+
+// Serial command functions
+void pollSerialCommands();
+void readArgument(byte code, byte length);
+void runArgumentCommand();
+void printIsrProfile();
+
+// Telemetry functions
+void reportTime();
+void reportAlarm(byte index);
+
+// Settings functions
+void loadSettings();
+void saveSettings();
+void changeBrightness(int step);
 
 #endif
\ No newline at end of file
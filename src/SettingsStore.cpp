@@ -0,0 +1,115 @@
+#include <MCP79412RTC.h>
+#include <util/crc16.h>
+
+#include "SettingsStore.h"
+
+SettingsStore::SettingsStore()
+{
+	memset(&_record, 0, sizeof(_record));
+	_record.sequence = 0xFF; // the first save goes to slot 0
+	_pending = false;
+	_changed = 0;
+}
+
+bool SettingsStore::load(Settings &settings)
+{
+	RTC.sramRead(SETTINGS_SRAM_ADDR, (byte *) &_record, SETTINGS_RECORD);
+
+	if (isValid(_record))
+	{
+		// an edit the EEPROM has not seen yet survived the reset
+		_pending = _record.version & SETTINGS_PENDING;
+		_changed = millis();
+		settings = _record.settings;
+		return true;
+	}
+
+	// The SRAM lost power, fall back to the newest record of the log.
+	// Sequence numbers of valid slots are at most SETTINGS_SLOTS apart,
+	// so the newest is ahead of all others modulo 256.
+	bool found = false;
+	for (byte slot = 0; slot < SETTINGS_SLOTS; slot++)
+	{
+		Record record;
+		RTC.eepromRead(SETTINGS_EEPROM_ADDR + slot * SETTINGS_RECORD, (byte *) &record,
+			SETTINGS_RECORD);
+
+		if (!isValid(record) || (record.version & SETTINGS_PENDING))
+			continue;
+
+		if (!found || (byte) (record.sequence - _record.sequence) < 128)
+		{
+			_record = record;
+			found   = true;
+		}
+	}
+
+	if (!found)
+	{
+		memset(&_record, 0, sizeof(_record));
+		_record.sequence = 0xFF;
+		return false;
+	}
+
+	writeSram();
+	settings = _record.settings;
+	return true;
+}
+
+void SettingsStore::save(const Settings &settings)
+{
+	if (!memcmp(&settings, &_record.settings, sizeof(settings)))
+		return;
+
+	// edits before the EEPROM write share its sequence number and slot
+	if (!_pending)
+		_record.sequence++;
+
+	_record.settings = settings;
+	_record.version  = SETTINGS_VERSION | SETTINGS_PENDING;
+	_pending = true;
+	_changed = millis();
+	writeSram();
+}
+
+void SettingsStore::poll()
+{
+	if (_pending && (millis() - _changed) >= SETTINGS_WRITE_DELAY)
+		flush();
+}
+
+void SettingsStore::flush()
+{
+	if (!_pending)
+		return;
+
+	_record.version = SETTINGS_VERSION;
+	_record.crc     = crc(_record);
+	byte addr = SETTINGS_EEPROM_ADDR + (_record.sequence & (SETTINGS_SLOTS - 1)) * SETTINGS_RECORD;
+	for (byte i = 0; i < SETTINGS_RECORD; i += SETTINGS_PAGE)
+		RTC.eepromWrite(addr + i, (byte *) &_record + i, SETTINGS_PAGE);
+
+	_pending = false;
+	writeSram();
+}
+
+bool SettingsStore::isValid(const Record &record)
+{
+	return (record.version & ~SETTINGS_PENDING) == SETTINGS_VERSION && crc(record) == record.crc;
+}
+
+byte SettingsStore::crc(const Record &record)
+{
+	const byte *data = (const byte *) &record;
+	byte crc = 0;
+
+	for (byte i = 0; i < SETTINGS_RECORD - 1; i++)
+		crc = _crc8_ccitt_update(crc, data[i]);
+	return crc;
+}
+
+void SettingsStore::writeSram()
+{
+	_record.crc = crc(_record);
+	RTC.sramWrite(SETTINGS_SRAM_ADDR, (byte *) &_record, SETTINGS_RECORD);
+}
@@ -0,0 +1,73 @@
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+#include <Arduino.h>
+
+// Records are two EEPROM pages: a sequence number, the settings, a
+// version and a CRC-8 of the rest. The battery-backed SRAM holds the
+// newest one, so boot is a single read; the EEPROM keeps a ring of
+// them, slot = sequence % SETTINGS_SLOTS, for when the battery ran out.
+// A write cut between the two pages fails the CRC, and the slot before
+// it is used instead.
+#define SETTINGS_RECORD      16
+#define SETTINGS_PAGE        8    // EEPROM bytes one write can take
+#define SETTINGS_SLOTS       8    // records in the log, a power of two
+#define SETTINGS_EEPROM_ADDR 0x00
+#define SETTINGS_SRAM_ADDR   0x00
+#define SETTINGS_VERSION     2
+#define SETTINGS_PENDING     0x80 // version flag, in SRAM only: the EEPROM lags behind
+#define SETTINGS_WRITE_DELAY 5000 // ms without a change before the EEPROM write
+
+#define SETTINGS_ALARMS       4    // entries of the alarm table
+#define SETTINGS_ALARM_HOUR   0x1F // AlarmSettings::hour bits
+#define SETTINGS_ALARM_ON     0x80 // flags above them
+#define SETTINGS_ALARM_REPEAT 0x40
+
+struct AlarmSettings
+{
+	byte hour;     // and SETTINGS_ALARM_* flags
+	byte minute;
+	byte weekdays;
+};
+
+struct Settings
+{
+	AlarmSettings alarms[SETTINGS_ALARMS];
+	byte brightness;
+};
+
+// Keeps Settings in the MCP79412. A change goes to the SRAM straight
+// away, the EEPROM write waits until no change came for
+// SETTINGS_WRITE_DELAY ms, so a burst of edits costs one record write.
+class SettingsStore
+{
+	public:
+		SettingsStore();
+		// the newest valid record, false when there is none
+		bool load(Settings &settings);
+		void save(const Settings &settings);
+		// writes a settled change to the EEPROM, called from loop()
+		void poll();
+		void flush();
+
+	private:
+		struct Record
+		{
+			byte     sequence;
+			Settings settings;
+			byte     version;
+			byte     crc;
+		};
+
+		// the SRAM copy and the EEPROM slots are addressed in SETTINGS_RECORD steps
+		static_assert(sizeof(Record) == SETTINGS_RECORD, "a record must fill one slot exactly");
+
+		Record        _record;
+		bool          _pending;
+		unsigned long _changed;
+
+		static bool isValid(const Record &record);
+		static byte crc(const Record &record);
+		void writeSram();
+};
+
+#endif
@@ -1,359 +1,89 @@
 #include "SevenSegController.h"
-#include "TimerOne.h"
 
+// Common anode segment patterns, one bit per segment from a (MSB) to the
+// decimal point (LSB), low means lit. Values 0-9 are the raw digits used
+// by the numeric displays, 32-126 are printable ASCII; characters that
+// cannot be drawn on seven segments are left blank.
+static const byte _glyphs[128] PROGMEM = {
+	B00000011, B10011111, B00100101, B00001101, B10011001, B01001001, B01000001, B00011111,  // 0 - 7 (raw digit values)
+	B00000001, B00001001, B11111111, B11111111, B11111111, B11111111, B11111111, B11111111,  // 8, 9, unused
+	B11111111, B11111111, B11111111, B11111111, B11111111, B11111111, B11111111, B11111111,  // unused
+	B11111111, B11111111, B11111111, B11111111, B11111111, B11111111, B11111111, B11111111,  // unused
+	B11111111, B10111110, B10111011, B11111111, B01001001, B11111111, B11111111, B11111011,  //   ! " # $ % & '
+	B01100011, B00001111, B11111111, B11111111, B11111110, B11111101, B11111110, B10110101,  // ( ) * + , - . /
+	B00000011, B10011111, B00100101, B00001101, B10011001, B01001001, B01000001, B00011111,  // 0 1 2 3 4 5 6 7
+	B00000001, B00001001, B11111111, B11111111, B11111111, B11101101, B11111111, B00110101,  // 8 9 : ; < = > ?
+	B11111111, B00010001, B11000001, B01100011, B10000101, B01100001, B01110001, B01000011,  // @ A B C D E F G
+	B10010001, B11110011, B10000111, B01010001, B11100011, B01010111, B00010011, B00000011,  // H I J K L M N O
+	B00110001, B00011001, B00010001, B01001001, B11100001, B10000011, B10000011, B10101011,  // P Q R S T U V W
+	B10010001, B10001001, B00100101, B01100011, B11011001, B00001111, B00111011, B11101111,  // X Y Z [ \ ] ^ _
+	B10111111, B11000101, B11000001, B11100101, B10000101, B00100001, B01110001, B00001001,  // ` a b c d e f g
+	B11010001, B11011111, B11001111, B01010001, B11100011, B01010111, B11010101, B11000101,  // h i j k l m n o
+	B00110001, B00011001, B11110101, B01001001, B11100001, B11000111, B11000111, B10101011,  // p q r s t u v w
+	B10010001, B10001001, B00100101, B01100011, B10011111, B00001111, B01111111, B11111111,  // x y z { | } ~ DEL
+};
 
-SevenSegController *SevenSegController::active_object = 0;
+// Perceived brightness in eight steps (brightness >> 5) to the number
+// of lit sub-slot units out of _BCM_FULL, gamma 2.2. The first step is
+// kept at one unit so the dimmest setting still shows.
+static const byte _gammaLevels[8] PROGMEM = {1, 1, 2, 3, 5, 8, 11, 15};
 
+void (*sevenSegTransferComplete)() = 0;
 
-SevenSegController::SevenSegController(int muxPin0, int muxPin1, int muxPin2, int muxPin3, int colonPin, int degreePin, int latchPin, int dataPin, int clkPin)
+byte sevenSegGlyph(char digit)
 {
-	active_object = this;
+	byte index = (byte) digit;
 
-	_muxPins[0] = muxPin0;
-	_muxPins[1] = muxPin1;
-	_muxPins[2] = muxPin2;
-	_muxPins[3] = muxPin3;
+	if (index >= sizeof(_glyphs))
+		return B11111111;
 
-	for (int i = 0; i < _NO_DIGITS; ++i)
-	{
-		_digitStatus [i] = 0;
-		_digitStatus [i] = _ENABLE_DIGIT;
-		_blinkCounter[i] = 0;
-		_showDecimal [i] = 0;
-	}
-
-	_colonPin   = colonPin;
-	_degreePin  = degreePin;
-	_latchPin   = latchPin;
-	_dataPin    = dataPin;
-	_clkPin     = clkPin;
-	_brightness = 255;
-	_selectedDigit = 0;
-
-	pinMode(_muxPins[0], OUTPUT);
-	pinMode(_muxPins[1], OUTPUT);
-	pinMode(_muxPins[2], OUTPUT);
-	pinMode(_muxPins[3], OUTPUT);
-	pinMode(_colonPin , OUTPUT);
-	pinMode(_degreePin, OUTPUT);
-	pinMode(_latchPin , OUTPUT);
-	pinMode(_dataPin  , OUTPUT);
-	pinMode(_clkPin   , OUTPUT);
-
-	Timer1.initialize(_MUX_PERIOD);
-	Timer1.attachInterrupt(handle_interrupt);
-}
-
-void SevenSegController::writeDigit(byte digit, char value)
-{
-	_digitValues[digit] = value;
-}
-
-void SevenSegController::writeDigit(byte digit, byte value)
-{
-	_digitValues[digit] = (char) value;
-}
-
-void SevenSegController::writeMessage(const char* msg)
-{
-	for (int i = 0; i < _NO_DIGITS; i++)
-		writeDigit(i, msg[i]);
-}
-
-void SevenSegController::disableDigit(byte digit)
-{
-	_digitStatus[digit] = _DISABLE_DIGIT;
-}
-
-void SevenSegController::enableDigit(byte digit)
-{
-	_digitStatus[digit] = _ENABLE_DIGIT;
-}
-
-void SevenSegController::enableDecimalPoint(byte digit)
-{
-	_showDecimal[digit] = 0xFE;
-}
-
-void SevenSegController::disableDecimalPoint(byte digit)
-{
-	_showDecimal[digit] = 0xFF;
-}
-
-void SevenSegController::enableBlink(byte digit)
-{
-	_digitStatus[digit] = _BLINK_DIGIT;
-}
-
-void SevenSegController::disableBlink(byte digit)
-{
-	enableDigit(digit);
-}
-
-void SevenSegController::setBrightness(byte brightness)
-{
-	_brightness = brightness;
-}
-
-void SevenSegController::enableDegreeSign()
-{
-	digitalWrite(_degreePin, HIGH);
-}
-
-void SevenSegController::disableDegreeSign()
-{
-	digitalWrite(_degreePin, LOW);
-}
-
-void SevenSegController::enableColon()
-{
-	digitalWrite(_colonPin, HIGH);
-}
-
-void SevenSegController::disableColon()
-{
-	digitalWrite(_colonPin, LOW);
+	return pgm_read_byte(&_glyphs[index]);
 }
 
-void SevenSegController::enableBlinkDisplay()
+byte sevenSegDutyLevel(byte brightness)
 {
-	for (int i = 0; i < _NO_DIGITS; ++i)
-		_digitStatus[i] = _BLINK_DIGIT;
+	return pgm_read_byte(&_gammaLevels[brightness >> 5]);
 }
 
-void SevenSegController::disableBlinkDisplay()
+unsigned int sevenSegPrescale()
 {
-	enableDisplay();
-}
-
-void SevenSegController::enableDisplay()
-{
-	for (int i = 0; i < _NO_DIGITS; ++i)
-		_digitStatus[i] = _ENABLE_DIGIT;
-
-	muxDisplay();
-	Timer1.attachInterrupt(handle_interrupt);
-}
+	// Timer1 runs phase correct, so a count is one prescaled clock
+	static const unsigned int prescale[] = {0, 1, 8, 64, 256, 1024, 0, 0};
 
-void SevenSegController::disableDisplay()
-{
-	for (int i = 0; i < _NO_DIGITS; ++i)
-		_digitStatus[i] = _DISABLE_DIGIT;
-	
-	muxDisplay();
-	Timer1.detachInterrupt();
+	return prescale[TCCR1B & 0x07];
 }
 
-void SevenSegController::enableClockDisplay()
+SevenSegController::SevenSegController(int muxPin0, int muxPin1, int muxPin2, int muxPin3, int colonPin, int degreePin, int latchPin, int dataPin, int clkPin, byte transport)
+	: SevenSegDisplay(pinMap(muxPin0, muxPin1, muxPin2, muxPin3, colonPin, degreePin, latchPin, dataPin, clkPin), transport)
 {
-	disableDegreeSign();
-
-	enableDigit(0);
-	enableDigit(1);
-	enableDigit(2);
-	enableDigit(3);
-
-	disableDecimalPoint(0);
-	disableDecimalPoint(1);
-	disableDecimalPoint(2);
-	disableDecimalPoint(3);
-
-	enableColon();
 }
 
-void SevenSegController::enableTempDisplay()
+SevenSegRuntimePins<_NO_DIGITS> SevenSegController::pinMap(int muxPin0, int muxPin1, int muxPin2, int muxPin3, int colonPin, int degreePin, int latchPin, int dataPin, int clkPin)
 {
-	disableColon();
-	
-	enableDigit(0);
-	enableDigit(1);
-	enableDigit(2);
-	disableDigit(3);
-
-	disableDecimalPoint(0);
-	disableDecimalPoint(2);
-	disableDecimalPoint(3);
-	enableDecimalPoint(1);
+	const byte pins[] = {(byte) muxPin0, (byte) muxPin1, (byte) muxPin2, (byte) muxPin3,
+		(byte) colonPin, (byte) degreePin, (byte) latchPin, (byte) dataPin, (byte) clkPin};
 
-	enableDegreeSign();
-}
-
-void SevenSegController::enableNumericDisplay()
-{
-	disableColon();
-	enableDigit(0);
-	enableDigit(1);
-	enableDigit(2);
-	enableDigit(3);
-	disableDecimalPoint(0);
-	disableDecimalPoint(1);
-	disableDecimalPoint(2);
-	disableDecimalPoint(3);
-	disableDegreeSign();
+	return SevenSegRuntimePins<_NO_DIGITS>(pins);
 }
 
 // ------------------------------ //
 //   Interrupt code
 // ------------------------------ //
 
-
-void SevenSegController::handle_interrupt()
-{
-	active_object->muxDisplay();
-}
-
-// void SevenSegController::muxDisplay(void)
-// {
-//     byte value = ( (translateDigit(_digitValues[_selectedDigit])) & _showDecimal[_selectedDigit] );
-//     digitalWrite(_latchPin, LOW);
-//     shiftOut(_dataPin, _clkPin, LSBFIRST, value);
-
-//     digitalWrite(_muxPins[0], LOW);
-//     digitalWrite(_muxPins[1], LOW);
-//     digitalWrite(_muxPins[2], LOW);
-//     digitalWrite(_muxPins[3], LOW);
-
-//     if (_digitStatus[_selectedDigit] == 1)
-//     {
-
-//       analogWrite(_muxPins[_selectedDigit], _brightness);
-
-//     } else if (_digitStatus[_selectedDigit] == 2)
-//     {
-//       if (_blinkCounter[_selectedDigit] < 2 * _BLINK_PERIOD)
-//       {
-//         if (_blinkCounter[_selectedDigit] < _BLINK_PERIOD)
-//         {
-//           analogWrite(_muxPins[_selectedDigit], _brightness);
-//         }
-//         _blinkCounter[_selectedDigit]++;
-
-//       } else {
-//         _blinkCounter[_selectedDigit] = 0;
-//       }
-//     }
-
-//     digitalWrite(_latchPin, HIGH);
-
-//     _selectedDigit++;
-//     _selectedDigit %= _NO_DIGITS;
-// }
-
-void SevenSegController::muxDisplay(void)
+#if defined(SPDR)
+ISR(SPI_STC_vect)
 {
-	byte value = ( (translateDigit(_digitValues[_selectedDigit])) & _showDecimal[_selectedDigit] );
-	digitalWrite(_latchPin, LOW);
-	shiftOut(_dataPin, _clkPin, LSBFIRST, value);
-
-	digitalWrite(_muxPins[0], LOW);
-	digitalWrite(_muxPins[1], LOW);
-	digitalWrite(_muxPins[2], LOW);
-	digitalWrite(_muxPins[3], LOW);
-
-	if (_digitStatus[_selectedDigit] == _ENABLE_DIGIT)
-	{
-		digitalWrite(_muxPins[_selectedDigit], HIGH);
-
-	} else if (_digitStatus[_selectedDigit] == _BLINK_DIGIT)
-	{
-		
-		if (_blinkCounter[_selectedDigit] < 2 * _BLINK_PERIOD)
-		{
-			
-			if (_blinkCounter[_selectedDigit] < _BLINK_PERIOD)
-			{
-				digitalWrite(_muxPins[_selectedDigit], HIGH);
-			}
-
-			_blinkCounter[_selectedDigit]++;
-
-		} else
-		{
-			_blinkCounter[_selectedDigit] = 0;
-		}
-	}
-
-	digitalWrite(_latchPin, HIGH);
-
-	_selectedDigit++;
-	_selectedDigit %= _NO_DIGITS;
+	if (sevenSegTransferComplete)
+		sevenSegTransferComplete();
 }
+#endif
 
-
-byte SevenSegController::translateDigit(char digit)
+#if defined(UDR0)
+// USART0 is shared with Serial, so this transport cannot be used
+// together with Serial.begin().
+ISR(USART_TX_vect)
 {
-	byte returnVal = 0;
-
-	switch (digit)
-	{
-		case 0:
-		case 'O':
-			returnVal =  B00000011;
-			break;
-		case 1:
-			returnVal =  B10011111;
-			break;
-		case 2:
-			returnVal =  B00100101;
-			break;
-		case 3:
-			returnVal =  B00001101;
-			break;
-		case 4:
-			returnVal =  B10011001;
-			break;
-		case 5:
-			returnVal =  B01001001;
-			break;
-		case 6:
-			returnVal =  B01000001;
-			break;
-		case 7:
-			returnVal =  B00011111;
-			break;
-		case 8:
-			returnVal =  B00000001;
-			break;
-		case 9:
-			returnVal =  B00001001;
-			break;
-		case 'A':
-		case 'R':
-			returnVal =  B00010001;
-			break;
-		case 'a':
-		case 'o':
-			returnVal =  B11000101;
-			break;
-		case 'E':
-			returnVal =  B01100001;
-			break;
-		case 'f':
-		case 'F':
-			returnVal =  B01110001;
-			break;
-		case 'n':
-			returnVal =  B11010101;
-			break;
-		case 'N':
-			returnVal =  B00010011;
-			break;  
-		case 'h':
-			returnVal =  B11010001;
-			break;
-		case 'l':
-			returnVal =  B11100011; 
-			break;  
-		case 'r':
-			returnVal =  B11110101; 
-			break;      
-		case 'u':
-			returnVal =  B11000111;
-			break;
-		default:
-			returnVal =  B11111111;
-			break;
-	}
-
-	return returnVal;
+	if (sevenSegTransferComplete)
+		sevenSegTransferComplete();
 }
+#endif
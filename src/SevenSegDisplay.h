@@ -0,0 +1,1084 @@
+#ifndef SevenSegDisplay_h
+#define SevenSegDisplay_h
+
+#include <Arduino.h>
+#include <TimerOne.h>
+#include "FastPin.h"
+
+#define _REFRESH_RATE     200 // default full-frame refresh rate, Hz
+#define _MIN_REFRESH_RATE  50
+#define _MAX_REFRESH_RATE 400
+#define _ISR_HEADROOM       4 // the mux ISR may use at most 1/4 of a digit slot
+#define _BLINK_PERIOD     800 // blink on/off time, ms
+#define _BCM_BITS           4 // binary code modulation depth, 16 duty levels
+#define _BCM_FULL  ((1 << _BCM_BITS) - 1)
+
+#define _BLINK_DIGIT     2
+#define _ENABLE_DIGIT    1
+#define _DISABLE_DIGIT   0
+
+// colon and degree sign bits in _signs
+#define _COLON_SIGN      0x01
+#define _DEGREE_SIGN     0x02
+
+// message layer, shown by the mux ISR over the frame
+#define _MESSAGE_LENGTH  24     // segment strip, blanks included
+#define _MESSAGE_FOREVER 0xFFFF // frames of a message shown until replaced
+#define _SCROLL_STEP     300    // default marquee step, ms per character
+#define _SCROLL_GAP      2      // blanks between two passes of a marquee
+
+// how the segment byte reaches the 74HC595
+#define _TRANSPORT_BITBANG   0 // any data/clock pins, shifted out in the mux ISR
+#define _TRANSPORT_SPI       1 // hardware SPI, data on MOSI, clock on SCK
+#define _TRANSPORT_USART_SPI 2 // USART0 in master SPI mode, data on TXD, clock on XCK
+
+// Opt-in profile of the mux ISR. Each run pushes its Timer1 count at
+// entry and exit into a ring the main loop drains with drainIsrProfile().
+#ifndef _ISR_PROFILE
+#define _ISR_PROFILE 0
+#endif
+#define _ISR_PROFILE_SAMPLES 32 // power of two
+
+#if _ISR_PROFILE
+// mux ISR statistics since the last getIsrProfile(), in CPU cycles.
+// Timer1 overflows at BOTTOM, so the count at entry is how late the run
+// started; its spread is the jitter of the ISR start times.
+struct IsrProfile
+{
+	unsigned long runs;
+	unsigned int  lost;        // runs dropped because the ring was full
+	unsigned long execMin;
+	unsigned long execMax;
+	unsigned long execMean;
+	unsigned long latencyMin;
+	unsigned long latencyMax;
+	unsigned long jitterMax;   // largest latency change between two runs
+};
+#endif
+
+// shared by every display type, in SevenSegController.cpp
+// translates from ASCII, or a raw 0-9 digit, to common anode segments
+byte sevenSegGlyph(char digit);
+// brightness 0-255 to a duty level out of _BCM_FULL, gamma corrected
+byte sevenSegDutyLevel(byte brightness);
+// CPU cycles per Timer1 count at the running prescaler
+unsigned int sevenSegPrescale();
+// latches the display, set by the display using a hardware transport
+extern void (*sevenSegTransferComplete)();
+
+// ---------------------- //
+//  pin drivers
+// ---------------------- //
+// The display reaches its pins only through one of these: digit
+// anodes by index, colon, degree sign, and the 74HC595 latch, data and
+// clock.
+
+// Pins given as template arguments, the digit anodes last, one per
+// digit. Nothing is kept in RAM. A fixed pin is one sbi or cbi, a digit
+// by index a few compares first; switching all digits off is one
+// masked store per port used.
+template <uint8_t colonPin, uint8_t degreePin, uint8_t latchPin, uint8_t dataPin,
+	uint8_t clkPin, uint8_t... muxPins>
+class SevenSegPins
+{
+	public:
+		static const byte digits = sizeof...(muxPins);
+
+		void begin(bool shiftPins)
+		{
+			MuxPins::begin();
+			StaticPin<colonPin>::begin();
+			StaticPin<degreePin>::begin();
+			StaticPin<latchPin>::begin();
+			if (shiftPins)
+			{
+				StaticPin<dataPin>::begin();
+				StaticPin<clkPin>::begin();
+			}
+		}
+
+		inline void digitsOff()
+		{
+			portOff(PB);
+			portOff(PC);
+			portOff(PD);
+		}
+
+		inline void digitOn(byte digit)  { MuxPins::high(digit); }
+		inline void digitOff(byte digit) { MuxPins::low(digit); }
+
+		inline void colon(bool on)  { if (on) StaticPin<colonPin>::high(); else StaticPin<colonPin>::low(); }
+		inline void degree(bool on) { if (on) StaticPin<degreePin>::high(); else StaticPin<degreePin>::low(); }
+		inline void latchHigh()     { StaticPin<latchPin>::high(); }
+		inline void latchLow()      { StaticPin<latchPin>::low(); }
+		inline void data(bool high) { if (high) StaticPin<dataPin>::high(); else StaticPin<dataPin>::low(); }
+		inline void clockPulse()    { StaticPin<clkPin>::toggle(); StaticPin<clkPin>::toggle(); }
+
+	private:
+		typedef StaticPinArray<muxPins...> MuxPins;
+
+		static inline void portOff(uint8_t port)
+		{
+			if (staticPortMask(port, muxPins...))
+				staticPortOutput(port) &= ~staticPortMask(port, muxPins...);
+		}
+};
+
+// Pins chosen at run time, through FastPin. Digit anodes first, then
+// colon, degree sign, latch, data and clock, as Arduino pin numbers.
+// The pins are made outputs on construction, like the original
+// controller did, so only their registers and masks are kept.
+template <byte DIGITS>
+class SevenSegRuntimePins
+{
+	public:
+		static const byte digits = DIGITS;
+
+		SevenSegRuntimePins(const byte *pins)
+			: _colonPin(pins[DIGITS]), _degreePin(pins[DIGITS + 1]), _latchPin(pins[DIGITS + 2]),
+			  _dataPin(pins[DIGITS + 3]), _clkPin(pins[DIGITS + 4])
+		{
+			for (byte i = 0; i < DIGITS; i++)
+				_muxPins[i] = FastPin(pins[i]);
+		}
+
+		// data and clock are outputs already, which the SPI and USART
+		// transports want as well
+		void begin(bool shiftPins) { (void) shiftPins; }
+
+		inline void digitsOff()
+		{
+			for (byte i = 0; i < DIGITS; i++)
+				_muxPins[i].low();
+		}
+
+		inline void digitOn(byte digit)  { _muxPins[digit].high(); }
+		inline void digitOff(byte digit) { _muxPins[digit].low(); }
+		inline void colon(bool on)       { if (on) _colonPin.high(); else _colonPin.low(); }
+		inline void degree(bool on)      { if (on) _degreePin.high(); else _degreePin.low(); }
+		inline void latchHigh()          { _latchPin.high(); }
+		inline void latchLow()           { _latchPin.low(); }
+		inline void data(bool high)      { if (high) _dataPin.high(); else _dataPin.low(); }
+		inline void clockPulse()         { _clkPin.toggle(); _clkPin.toggle(); }
+
+	private:
+		FastPin _muxPins[DIGITS];
+		FastPin _colonPin;
+		FastPin _degreePin;
+		FastPin _latchPin;
+		FastPin _dataPin;
+		FastTogglePin _clkPin;
+};
+
+// ---------------------- //
+//  display
+// ---------------------- //
+// Multiplexed common anode display of Pins::digits digits, driven from
+// the Timer1 interrupt through a 74HC595. Only one display can be
+// active, it takes over Timer1.
+template <class Pins>
+class SevenSegDisplay
+{
+	public:
+		static const byte digits = Pins::digits;
+
+		// for pins fixed at compile time
+		SevenSegDisplay(byte transport = _TRANSPORT_BITBANG);
+		SevenSegDisplay(const Pins &pins, byte transport = _TRANSPORT_BITBANG);
+
+		// write a single digit; digit values, decimal points, digit
+		// enable and blink, colon and degree sign all go to the back
+		// buffer and are only shown after commit()
+		void writeDigit(byte digit, char value);
+		void writeDigit(byte digit, byte value);
+		// the first digits characters of msg, see scrollMessage()
+		// for longer text
+		void writeMessage(const char* msg);
+		void commit();  // show the back buffer, atomically
+
+		// Shows msg over the whole display for duration ms, from the mux
+		// ISR, then goes back to the frame underneath on its own. The
+		// frame, colon and degree sign can still be changed meanwhile.
+		// Longer text than the display scrolls across once in that time.
+		void showMessageFor(const char* msg, unsigned int duration);
+		// Marquee: msg goes round the display one character every step
+		// ms, moved on by the mux ISR, until clearMessage() or the next
+		// message. Up to _MESSAGE_LENGTH - _SCROLL_GAP characters.
+		void scrollMessage(const char* msg, unsigned int step = _SCROLL_STEP);
+		void clearMessage();
+
+		// control functions - single digits
+		void disableDigit(byte digit);
+		void enableDigit(byte digit);
+		void enableDecimalPoint(byte digit);
+		void disableDecimalPoint(byte digit);
+		void enableColon();
+		void disableColon();
+		void enableDegreeSign();
+		void disableDegreeSign();
+		void enableBlink(byte digit);
+		void disableBlink(byte digit);
+		void setBrightness(byte brightness); // 0 (dimmest) to 255, gamma corrected
+		byte getBrightness();
+
+		// refresh rate of the whole display in Hz, clamped to
+		// [_MIN_REFRESH_RATE, _MAX_REFRESH_RATE] and to what the measured
+		// ISR cost allows. Returns the rate actually applied.
+		unsigned int setRefreshRate(unsigned int hz);
+		unsigned int getRefreshRate();
+		// longest mux ISR run seen so far, in microseconds
+		unsigned int getIsrWorstCase();
+#if _ISR_PROFILE
+		// moves the profile ring into the running statistics; call it
+		// often enough that _ISR_PROFILE_SAMPLES runs don't fill it
+		void drainIsrProfile();
+		// statistics since the last call, which starts a new window
+		void getIsrProfile(IsrProfile &profile);
+#endif
+
+		// control functions - whole display; enableDisplay() and
+		// disableDisplay() take effect at once and commit() the back buffer
+		void enableBlinkDisplay();
+		void disableBlinkDisplay();
+		void enableDisplay();   // display all digits
+		void disableDisplay();  // disable complete display, signs included
+
+		// high-level display modes
+		void enableClockDisplay();
+		void enableTempDisplay();
+		void enableNumericDisplay();
+
+		// function used to expose member interrupt function
+		static inline void handle_interrupt();
+		// called from the SPI / USART transfer complete interrupt
+		static inline void handle_transfer_complete();
+
+	private:
+		static_assert(digits > 0 && digits <= _MESSAGE_LENGTH, "the message strip is shorter than the display");
+
+		// pointer to handle timer1 interrupt
+		static SevenSegDisplay *active_object;
+
+		Pins _pins;
+		volatile byte _selectedDigit;
+		volatile byte _litDigit;       // digit to switch on once latched, digits for none
+		volatile byte _transport;
+		char _digitValues[digits]; // store values to display for each digit
+		volatile byte _segments[2][digits]; // front and back segment frames
+		volatile byte _front;                   // index of the frame shown by the ISR
+		volatile byte _digitStatus[2][digits]; // 0: disabled, 1: enabled, 2: blinking
+		volatile byte _message[_MESSAGE_LENGTH]; // segment strip of the message layer
+		volatile byte _messageLength;           // strip length, at least digits
+		volatile byte _messageOffset;           // strip index shown on digit 0
+		volatile unsigned int _messageFrames;   // frames left to show it, 0 when off
+		volatile unsigned int _scrollFrames;    // frames per scroll step, 0 to stand still
+		volatile unsigned int _scrollCount;
+		volatile bool _scrollLoop;              // wrap around instead of stopping at the end
+		volatile byte _signs[2];                // _COLON_SIGN and _DEGREE_SIGN, as requested
+		volatile bool _dark;                    // disableDisplay(), signs off too
+		byte _showDecimal[digits]; // 1: show, 0: do not show
+		int _blinkCounter[digits]; // used for timing blink pattern
+		volatile int _blinkFrames;     // frames per blink phase at the current refresh rate
+		unsigned int _refreshRate;
+		volatile unsigned int _isrWorstTicks; // in Timer1 counts
+		byte _brightness;  // define brightness from 0 to 255
+		volatile byte _dutyLevel;            // 0 to _BCM_FULL, from the gamma table
+		volatile byte _bcmBit;               // sub-slot being shown, _BCM_BITS at digit start
+		volatile byte _visibleDigit;         // digit lit during this slot, digits for none
+		volatile unsigned int _slotTop;      // Timer1 TOP for a whole digit slot
+		volatile unsigned int _bcmTop[_BCM_BITS]; // Timer1 TOP for each weighted sub-slot
+#if _ISR_PROFILE
+		volatile unsigned int _profileEntry[_ISR_PROFILE_SAMPLES]; // Timer1 counts
+		volatile unsigned int _profileExit[_ISR_PROFILE_SAMPLES];
+		volatile byte _profileHead;          // written by the ISR
+		volatile byte _profileTail;          // written by drainIsrProfile()
+		volatile unsigned int _profileLost;
+		unsigned long _profileRuns;          // running statistics, in Timer1 counts
+		unsigned long _profileExecSum;
+		unsigned int _profileExecMin;
+		unsigned int _profileExecMax;
+		unsigned int _profileLatencyMin;
+		unsigned int _profileLatencyMax;
+		unsigned int _profileJitterMax;
+		unsigned int _profileLastLatency;
+#endif
+
+		// shared by both constructors, once the pins are known
+		void init(byte transport);
+		// rebuilds the segment byte of a digit after its value or decimal point changed
+		void refreshSegments(byte digit);
+		// drives the colon and degree sign of the front frame, both off
+		// while a message is shown
+		void writeSigns();
+		// translates msg into the message strip, followed by gap blanks;
+		// returns the number of characters taken
+		byte loadMessage(const char* msg, byte gap);
+		void startMessage(unsigned int frames, unsigned int scrollFrames, bool loop);
+		// scrolls and expires the message, once per frame from the ISR
+		inline void advanceMessage();
+		// clocks a segment byte into the shift register, LSB first
+		inline void shiftSegments(byte value);
+		// sets up the SPI or USART peripheral for the hardware transports
+		void beginTransport();
+		// latches the shifted byte and lights the selected digit
+		inline void latchSegments();
+		// advances the binary code modulation to the next sub-slot
+		inline void bcmStep();
+		// moves Timer1 TOP, restarting the slot if the count is past it
+		static inline void setTop(unsigned int top);
+		// interrupt routine controlling display multiplexing
+		void muxDisplay(void);
+#if _ISR_PROFILE
+		// pushes one ISR run into the profile ring
+		inline void recordIsrRun(unsigned int entry, unsigned int exit);
+		void resetIsrProfile();
+#endif
+};
+
+// ------------------------------ //
+//   implementation
+// ------------------------------ //
+template <class Pins>
+SevenSegDisplay<Pins> *SevenSegDisplay<Pins>::active_object = 0;
+
+template <class Pins>
+SevenSegDisplay<Pins>::SevenSegDisplay(byte transport)
+{
+	init(transport);
+}
+
+template <class Pins>
+SevenSegDisplay<Pins>::SevenSegDisplay(const Pins &pins, byte transport) : _pins(pins)
+{
+	init(transport);
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::init(byte transport)
+{
+	active_object = this;
+
+	// a hardware transport may not exist on this MCU and fall back
+	_transport = transport;
+	if (_transport != _TRANSPORT_BITBANG)
+		beginTransport();
+	_pins.begin(_transport == _TRANSPORT_BITBANG);
+
+	_front = 0;
+
+	for (byte i = 0; i < digits; ++i)
+	{
+		_digitStatus [0][i] = _ENABLE_DIGIT;
+		_digitStatus [1][i] = _ENABLE_DIGIT;
+		_blinkCounter[i] = 0;
+		_showDecimal [i] = 0;
+		_digitValues [i] = 0;
+		refreshSegments(i);
+	}
+	_signs[0]      = 0;
+	_signs[1]      = 0;
+	_dark          = false;
+	_messageFrames = 0;
+	_messageLength = digits;
+	_messageOffset = 0;
+	_litDigit      = digits;
+	commit();
+
+	_selectedDigit = 0;
+	_bcmBit        = _BCM_BITS;
+	_visibleDigit  = digits;
+	setBrightness(255);
+
+	_isrWorstTicks = 0;
+#if _ISR_PROFILE
+	_profileHead = 0;
+	_profileTail = 0;
+	_profileLost = 0;
+	resetIsrProfile();
+#endif
+	Timer1.initialize();
+	setRefreshRate(_REFRESH_RATE);
+	Timer1.attachInterrupt(handle_interrupt);
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::writeDigit(byte digit, char value)
+{
+	_digitValues[digit] = value;
+	refreshSegments(digit);
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::writeDigit(byte digit, byte value)
+{
+	_digitValues[digit] = (char) value;
+	refreshSegments(digit);
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::writeMessage(const char* msg)
+{
+	for (byte i = 0; i < digits; i++)
+		writeDigit(i, msg[i]);
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::showMessageFor(const char* msg, unsigned int duration)
+{
+	// keeps the ISR off the strip while it is rewritten
+	clearMessage();
+	byte length = loadMessage(msg, 0);
+
+	unsigned long frames = (unsigned long) duration * _refreshRate / 1000;
+	frames = max(frames, 1UL);
+
+	// longer text takes its last step in time to be read to the end
+	unsigned int scrollFrames = 0;
+	if (length > digits)
+		scrollFrames = max(frames / (length - digits + 1), 1UL);
+
+	startMessage(frames, scrollFrames, false);
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::scrollMessage(const char* msg, unsigned int step)
+{
+	clearMessage();
+	loadMessage(msg, _SCROLL_GAP);
+
+	unsigned long scrollFrames = (unsigned long) step * _refreshRate / 1000;
+	startMessage(_MESSAGE_FOREVER, max(scrollFrames, 1UL), true);
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::clearMessage()
+{
+	noInterrupts();
+	_messageFrames = 0;
+	writeSigns();
+	interrupts();
+}
+
+template <class Pins>
+byte SevenSegDisplay<Pins>::loadMessage(const char* msg, byte gap)
+{
+	byte length = 0;
+	while (msg[length] && length < _MESSAGE_LENGTH - gap)
+	{
+		_message[length] = sevenSegGlyph(msg[length]);
+		length++;
+	}
+
+	// blanks for the gap, and for the digits short text leaves empty
+	_messageLength = max(length + gap, digits);
+	for (byte i = length; i < _messageLength; i++)
+		_message[i] = B11111111;
+
+	return length;
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::startMessage(unsigned int frames, unsigned int scrollFrames, bool loop)
+{
+	_messageOffset = 0;
+	_scrollFrames  = scrollFrames;
+	_scrollCount   = 0;
+	_scrollLoop    = loop;
+
+	noInterrupts();
+	_messageFrames = frames;
+	writeSigns();
+	interrupts();
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::commit()
+{
+	// the ISR sees either the old or the new frame, and the signs
+	// change between the same two mux ticks as the digits
+	noInterrupts();
+	_front ^= 1;
+	writeSigns();
+	interrupts();
+
+	// carry the shown frame over, so partial updates build on it
+	byte back = _front ^ 1;
+	for (byte i = 0; i < digits; ++i)
+	{
+		_segments   [back][i] = _segments   [_front][i];
+		_digitStatus[back][i] = _digitStatus[_front][i];
+	}
+	_signs[back] = _signs[_front];
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::disableDigit(byte digit)
+{
+	_digitStatus[_front ^ 1][digit] = _DISABLE_DIGIT;
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::enableDigit(byte digit)
+{
+	_digitStatus[_front ^ 1][digit] = _ENABLE_DIGIT;
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::enableDecimalPoint(byte digit)
+{
+	_showDecimal[digit] = 0xFE;
+	refreshSegments(digit);
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::disableDecimalPoint(byte digit)
+{
+	_showDecimal[digit] = 0xFF;
+	refreshSegments(digit);
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::refreshSegments(byte digit)
+{
+	_segments[_front ^ 1][digit] = sevenSegGlyph(_digitValues[digit]) & _showDecimal[digit];
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::enableBlink(byte digit)
+{
+	_digitStatus[_front ^ 1][digit] = _BLINK_DIGIT;
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::disableBlink(byte digit)
+{
+	enableDigit(digit);
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::setBrightness(byte brightness)
+{
+	_brightness = brightness;
+	// picked up by the ISR at the next digit
+	_dutyLevel  = sevenSegDutyLevel(brightness);
+}
+
+template <class Pins>
+byte SevenSegDisplay<Pins>::getBrightness()
+{
+	return _brightness;
+}
+
+template <class Pins>
+unsigned int SevenSegDisplay<Pins>::setRefreshRate(unsigned int hz)
+{
+	hz = constrain(hz, _MIN_REFRESH_RATE, _MAX_REFRESH_RATE);
+
+	// keep every digit slot at least _ISR_HEADROOM times longer than
+	// the slowest ISR run measured so far, and the shortest BCM
+	// sub-slot, 1/_BCM_FULL of it, longer than one run
+	unsigned long slotBudget = (unsigned long) getIsrWorstCase() * max(_ISR_HEADROOM, _BCM_FULL);
+	if (slotBudget)
+	{
+		unsigned long fastest = 1000000UL / (slotBudget * digits);
+		if (hz > fastest)
+			hz = max(fastest, _MIN_REFRESH_RATE);
+	}
+
+	_refreshRate = hz;
+	int blinkFrames = (unsigned long) _BLINK_PERIOD * hz / 1000;
+
+	// the ISR reads the blink length too, a two byte store
+	noInterrupts();
+	_blinkFrames = blinkFrames;
+	Timer1.setPeriod(1000000UL / ((unsigned long) hz * digits));
+
+	// sub-slot b lasts 2^b units of a slot split in _BCM_FULL units
+	_slotTop = ICR1;
+	for (byte b = 0; b < _BCM_BITS; b++)
+		_bcmTop[b] = (unsigned long) _slotTop * (1 << b) / _BCM_FULL;
+
+	_bcmBit = _BCM_BITS;
+	setTop(_slotTop);
+	interrupts();
+
+	return hz;
+}
+
+template <class Pins>
+unsigned int SevenSegDisplay<Pins>::getRefreshRate()
+{
+	return _refreshRate;
+}
+
+template <class Pins>
+unsigned int SevenSegDisplay<Pins>::getIsrWorstCase()
+{
+	noInterrupts();
+	unsigned long ticks = _isrWorstTicks;
+	interrupts();
+
+	return ticks * sevenSegPrescale() / (F_CPU / 1000000UL);
+}
+
+#if _ISR_PROFILE
+template <class Pins>
+void SevenSegDisplay<Pins>::drainIsrProfile()
+{
+	byte tail = _profileTail;
+
+	while (tail != _profileHead)
+	{
+		unsigned int latency = _profileEntry[tail];
+		unsigned int exec    = _profileExit[tail] - latency;
+		unsigned int jitter  = latency > _profileLastLatency ? 
+			latency - _profileLastLatency : _profileLastLatency - latency;
+
+		if (_profileRuns && jitter > _profileJitterMax)
+			_profileJitterMax = jitter;
+		_profileLastLatency = latency;
+
+		_profileExecMin    = min(_profileExecMin, exec);
+		_profileExecMax    = max(_profileExecMax, exec);
+		_profileLatencyMin = min(_profileLatencyMin, latency);
+		_profileLatencyMax = max(_profileLatencyMax, latency);
+		_profileExecSum   += exec;
+		_profileRuns++;
+
+		tail = (tail + 1) & (_ISR_PROFILE_SAMPLES - 1);
+	}
+
+	// hands the slots back to the ISR
+	_profileTail = tail;
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::getIsrProfile(IsrProfile &profile)
+{
+	unsigned long scale = sevenSegPrescale();
+
+	drainIsrProfile();
+
+	noInterrupts();
+	profile.lost = _profileLost;
+	_profileLost = 0;
+	interrupts();
+
+	profile.runs = _profileRuns;
+	if (_profileRuns)
+	{
+		profile.execMin    = _profileExecMin * scale;
+		profile.execMax    = _profileExecMax * scale;
+		profile.execMean   = _profileExecSum / _profileRuns * scale;
+		profile.latencyMin = _profileLatencyMin * scale;
+		profile.latencyMax = _profileLatencyMax * scale;
+		profile.jitterMax  = _profileJitterMax * scale;
+	} else
+	{
+		profile.execMin    = profile.execMax    = profile.execMean  = 0;
+		profile.latencyMin = profile.latencyMax = profile.jitterMax = 0;
+	}
+
+	resetIsrProfile();
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::resetIsrProfile()
+{
+	_profileRuns        = 0;
+	_profileExecSum     = 0;
+	_profileExecMin     = 0xFFFF;
+	_profileExecMax     = 0;
+	_profileLatencyMin  = 0xFFFF;
+	_profileLatencyMax  = 0;
+	_profileJitterMax   = 0;
+	_profileLastLatency = 0;
+}
+#endif
+
+template <class Pins>
+void SevenSegDisplay<Pins>::enableDegreeSign()
+{
+	_signs[_front ^ 1] |= _DEGREE_SIGN;
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::disableDegreeSign()
+{
+	_signs[_front ^ 1] &= ~_DEGREE_SIGN;
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::enableColon()
+{
+	_signs[_front ^ 1] |= _COLON_SIGN;
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::disableColon()
+{
+	_signs[_front ^ 1] &= ~_COLON_SIGN;
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::writeSigns()
+{
+	byte signs = _messageFrames || _dark ? 0 : _signs[_front];
+
+	_pins.colon(signs & _COLON_SIGN);
+	_pins.degree(signs & _DEGREE_SIGN);
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::enableBlinkDisplay()
+{
+	for (byte i = 0; i < digits; ++i)
+		_digitStatus[_front ^ 1][i] = _BLINK_DIGIT;
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::disableBlinkDisplay()
+{
+	enableDisplay();
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::enableDisplay()
+{
+	for (byte i = 0; i < digits; ++i)
+		_digitStatus[_front ^ 1][i] = _ENABLE_DIGIT;
+	_dark = false;
+	commit();
+
+	// the port writes in muxDisplay are not atomic, keep the ISR out
+	noInterrupts();
+	_bcmBit = _BCM_BITS;
+	muxDisplay();
+	// muxDisplay may have moved TOP below the running count
+	Timer1.restart();
+	interrupts();
+	Timer1.attachInterrupt(handle_interrupt);
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::disableDisplay()
+{
+	for (byte i = 0; i < digits; ++i)
+		_digitStatus[_front ^ 1][i] = _DISABLE_DIGIT;
+	_dark = true;
+	commit();
+
+	noInterrupts();
+	_bcmBit = _BCM_BITS;
+	muxDisplay();
+	interrupts();
+	Timer1.detachInterrupt();
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::enableClockDisplay()
+{
+	disableDegreeSign();
+
+	for (byte i = 0; i < digits; ++i)
+	{
+		enableDigit(i);
+		disableDecimalPoint(i);
+	}
+
+	enableColon();
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::enableTempDisplay()
+{
+	disableColon();
+
+	// three digits with one decimal, the degree sign after them
+	for (byte i = 0; i < digits; ++i)
+	{
+		if (i < 3)
+			enableDigit(i);
+		else
+			disableDigit(i);
+		disableDecimalPoint(i);
+	}
+	enableDecimalPoint(1);
+
+	enableDegreeSign();
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::enableNumericDisplay()
+{
+	disableColon();
+	for (byte i = 0; i < digits; ++i)
+	{
+		enableDigit(i);
+		disableDecimalPoint(i);
+	}
+	disableDegreeSign();
+}
+
+// ------------------------------ //
+//   Interrupt code
+// ------------------------------ //
+template <class Pins>
+void SevenSegDisplay<Pins>::handle_interrupt()
+{
+#if _ISR_PROFILE
+	unsigned int entry = TCNT1;
+#endif
+	active_object->muxDisplay();
+
+	// the overflow interrupt fires at BOTTOM and Timer1 counts up from
+	// there, so the counter now holds the time spent since the tick
+	unsigned int elapsed = TCNT1;
+	if (elapsed > active_object->_isrWorstTicks)
+		active_object->_isrWorstTicks = elapsed;
+
+#if _ISR_PROFILE
+	// a slot restarted by setTop() has no exit time to go by
+	if (elapsed >= entry)
+		active_object->recordIsrRun(entry, elapsed);
+#endif
+}
+
+#if _ISR_PROFILE
+template <class Pins>
+void SevenSegDisplay<Pins>::recordIsrRun(unsigned int entry, unsigned int exit)
+{
+	byte next = (_profileHead + 1) & (_ISR_PROFILE_SAMPLES - 1);
+	if (next == _profileTail)
+	{
+		_profileLost++;
+		return;
+	}
+
+	_profileEntry[_profileHead] = entry;
+	_profileExit[_profileHead]  = exit;
+	_profileHead = next;
+}
+#endif
+
+template <class Pins>
+void SevenSegDisplay<Pins>::handle_transfer_complete()
+{
+	active_object->latchSegments();
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::beginTransport()
+{
+	switch (_transport)
+	{
+#if defined(SPDR)
+		case _TRANSPORT_SPI:
+			// SS must stay an output, or a low level on it drops us out of master mode
+			pinMode(SS  , OUTPUT);
+			pinMode(MOSI, OUTPUT);
+			pinMode(SCK , OUTPUT);
+			// master, LSB first, mode 0, F_CPU/2, interrupt on completion
+			SPCR = _BV(SPE) | _BV(MSTR) | _BV(DORD) | _BV(SPIE);
+			SPSR = _BV(SPI2X);
+			sevenSegTransferComplete = handle_transfer_complete;
+			break;
+#endif
+
+#if defined(UDR0)
+		case _TRANSPORT_USART_SPI:
+			// XCK is PD4 on the ATmega328p; the baud register must be
+			// cleared before the transmitter is enabled
+			UBRR0  = 0;
+			pinMode(4, OUTPUT);
+			UCSR0C = _BV(UMSEL01) | _BV(UMSEL00) | _BV(UDORD0);
+			UCSR0B = _BV(TXEN0) | _BV(TXCIE0);
+			UBRR0  = 0;
+			sevenSegTransferComplete = handle_transfer_complete;
+			break;
+#endif
+
+		default:
+			// not available on this MCU
+			_transport = _TRANSPORT_BITBANG;
+			break;
+	}
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::shiftSegments(byte value)
+{
+	// same bit order as shiftOut(data, clock, LSBFIRST, value),
+	// with the clock idling low and pulsed through the PINx toggle.
+	for (byte i = 0; i < 8; i++)
+	{
+		_pins.data(value & 0x01);
+		_pins.clockPulse();
+		value >>= 1;
+	}
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::latchSegments()
+{
+	_pins.latchHigh();
+
+	if (_litDigit < digits)
+		_pins.digitOn(_litDigit);
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::setTop(unsigned int top)
+{
+	// ICR1 is not double-buffered in this mode. Written below the
+	// running count, say after a OneWire slot held the ISR off, the TOP
+	// is missed and Timer1 counts on to 0xFFFF: a 16 ms stall.
+	ICR1 = top;
+	if (TCNT1 >= top)
+		Timer1.restart();
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::bcmStep()
+{
+	// only the Timer1 TOP and one digit pin change here, so the short
+	// sub-slots are cheap; the shift and latch stay in the long first one.
+	_bcmBit--;
+	setTop(_bcmTop[_bcmBit]);
+
+	if (_visibleDigit < digits)
+	{
+		if (_dutyLevel & (1 << _bcmBit))
+			_pins.digitOn(_visibleDigit);
+		else
+			_pins.digitOff(_visibleDigit);
+	}
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::advanceMessage()
+{
+	if (_scrollFrames && ++_scrollCount >= _scrollFrames)
+	{
+		_scrollCount = 0;
+
+		if (_scrollLoop)
+		{
+			_messageOffset++;
+			if (_messageOffset >= _messageLength)
+				_messageOffset = 0;
+		} else if (_messageOffset + digits < _messageLength)
+		{
+			_messageOffset++;
+		}
+	}
+
+	if (_messageFrames != _MESSAGE_FOREVER && !--_messageFrames)
+		writeSigns();
+}
+
+template <class Pins>
+void SevenSegDisplay<Pins>::muxDisplay(void)
+{
+	// Binary code modulation: a dimmed digit slot is split in _BCM_BITS
+	// sub-slots weighted 2^b, shown from the heaviest down, with the
+	// digit lit in those whose bit is set in _dutyLevel.
+	if (_bcmBit < _BCM_BITS && _bcmBit > 0)
+	{
+		bcmStep();
+		return;
+	}
+
+	// segments and status from the same frame
+	byte front = _front;
+	byte value;
+	if (_messageFrames)
+	{
+		byte index = _messageOffset + _selectedDigit;
+		if (index >= _messageLength)
+			index -= _messageLength;
+		value = _message[index];
+	} else
+	{
+		value = _segments[front][_selectedDigit];
+	}
+	_pins.latchLow();
+	_pins.digitsOff();
+
+	_litDigit = digits;
+
+	byte status = _digitStatus[front][_selectedDigit];
+	if (_messageFrames || status == _ENABLE_DIGIT)
+	{
+		_litDigit = _selectedDigit;
+
+	} else if (status == _BLINK_DIGIT)
+	{
+		int blinkFrames = _blinkFrames;
+
+		if (_blinkCounter[_selectedDigit] < 2 * blinkFrames)
+		{
+			
+			if (_blinkCounter[_selectedDigit] < blinkFrames)
+			{
+				_litDigit = _selectedDigit;
+			}
+
+			_blinkCounter[_selectedDigit]++;
+
+		} else
+		{
+			_blinkCounter[_selectedDigit] = 0;
+		}
+	}
+
+	_visibleDigit = _litDigit;
+
+	if (_dutyLevel == _BCM_FULL)
+	{
+		// full brightness, one interrupt per digit
+		if (_bcmBit < _BCM_BITS)
+		{
+			setTop(_slotTop);
+			_bcmBit = _BCM_BITS;
+		}
+	} else
+	{
+		_bcmBit = _BCM_BITS - 1;
+		setTop(_bcmTop[_bcmBit]);
+
+		if (!(_dutyLevel & (1 << _bcmBit)))
+			_litDigit = digits;
+	}
+
+	switch (_transport)
+	{
+#if defined(SPDR)
+		case _TRANSPORT_SPI:
+			// latched from the transfer complete interrupt
+			SPDR = value;
+			break;
+#endif
+
+#if defined(UDR0)
+		case _TRANSPORT_USART_SPI:
+			UDR0 = value;
+			break;
+#endif
+
+		default:
+			shiftSegments(value);
+			latchSegments();
+			break;
+	}
+
+	// cheaper than a modulo for digit counts that are not a power of two
+	if (++_selectedDigit >= digits)
+		_selectedDigit = 0;
+
+	// messages scroll and expire in whole frames
+	if (_selectedDigit == 0 && _messageFrames)
+		advanceMessage();
+}
+
+#endif
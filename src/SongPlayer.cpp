@@ -0,0 +1,93 @@
+#include "SongPlayer.h"
+
+// C8 to B8 in Hz, lower octaves are shifted down from these
+#define TOP_OCTAVE 9 // MIDI note number / 12 of C8
+
+const unsigned int topOctave[12] PROGMEM = {
+	4186, 4435, 4699, 4978, 5274, 5588, 5920, 6272, 6645, 7040, 7459, 7902
+};
+
+SongPlayer::SongPlayer()
+{
+	_song      = NULL;
+	_event     = 0;
+	_repeat    = 0;
+	_gap       = true;
+	_frequency = 0;
+	_duration  = 0;
+	_start     = 0;
+}
+
+void SongPlayer::start(const byte *song)
+{
+	_song   = song;
+	_event  = 0;
+	_repeat = 0;
+	load(millis());
+}
+
+bool SongPlayer::update(unsigned long now)
+{
+	if (!_song || (now - _start) < _duration)
+		return false;
+
+	// timed from when the last sound was due to end, not from when
+	// loop() got here, so the tempo does not drift
+	unsigned long end = _start + _duration;
+
+	if (!_gap)
+	{
+		_gap       = true;
+		_frequency = 0;
+		_duration  = pgm_read_byte(_song + 2);
+		_start     = end;
+		return true;
+	}
+
+	const byte *event = _song + SONG_HEADER + _event * SONG_EVENT;
+	if (_repeat < (pgm_read_byte(event + 1) >> 4))
+	{
+		_repeat++;
+	} else
+	{
+		_repeat = 0;
+		_event++;
+		// roll over, once finished
+		_event %= pgm_read_byte(_song + 3);
+	}
+
+	load(end);
+	return true;
+}
+
+unsigned int SongPlayer::frequency()
+{
+	return _frequency;
+}
+
+void SongPlayer::load(unsigned long now)
+{
+	const byte *event = _song + SONG_HEADER + _event * SONG_EVENT;
+	byte note = pgm_read_byte(event);
+	byte gap  = pgm_read_byte(_song + 2);
+
+	_duration  = noteLength();
+	_start     = now;
+	_frequency = note == SONG_REST ? 0 :
+		pgm_read_word(&topOctave[note % 12]) >> (TOP_OCTAVE - note / 12);
+
+	// a rest, or a note too short to cut the silence from, is one sound
+	_gap = !_frequency || gap >= _duration;
+	if (!_gap)
+		_duration -= gap;
+}
+
+unsigned int SongPlayer::noteLength()
+{
+	byte length = pgm_read_byte(_song + SONG_HEADER + _event * SONG_EVENT + 1);
+	unsigned int ms = pgm_read_word(_song) >> (length & SONG_VALUE);
+
+	if (length & SONG_DOTTED)
+		ms += ms >> 1;
+	return ms;
+}
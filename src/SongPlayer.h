@@ -0,0 +1,45 @@
+#ifndef SONG_PLAYER_H
+#define SONG_PLAYER_H
+#include <Arduino.h>
+
+// Songs are byte arrays in flash, written by host/tools/mexclk-rtttl:
+// a header of the whole note length in ms (little endian), the silence
+// cut from the end of every note in ms and the number of events, then
+// two bytes per event:
+//  note:   MIDI note number, SONG_REST for a rest
+//  length: (repeats - 1) << 4 | SONG_DOTTED | log2 of the note value,
+//          so 2 is a quarter note and 4 | SONG_DOTTED a dotted 16th
+#define SONG_HEADER  4
+#define SONG_EVENT   2
+#define SONG_REST    0
+#define SONG_DOTTED  0x08
+#define SONG_VALUE   0x07
+#define SONG_REPEATS 0xF0
+
+// Steps through a song one note at a time, from loop(), and starts over
+// at the end.
+class SongPlayer
+{
+	public:
+		SongPlayer();
+		void start(const byte *song);
+		// Moves on once the current sound has run for its time, true
+		// when it did and frequency() changed.
+		bool update(unsigned long now);
+		// Hz of the current sound, 0 for silence
+		unsigned int frequency();
+
+	private:
+		const byte *_song;
+		byte _event;
+		byte _repeat;
+		bool _gap;                // in the silence after a note
+		unsigned int _frequency;
+		unsigned int _duration;   // of the current sound, ms
+		unsigned long _start;
+
+		void load(unsigned long now);
+		unsigned int noteLength();
+};
+
+#endif
@@ -0,0 +1,18 @@
+// Generated by mexclk-rtttl from Songs.rtttl, do not edit.
+#ifndef SONGS_H
+#define SONGS_H
+#include "SongPlayer.h"
+
+// 1690 ms whole note, 42 ms gap, 16 bytes
+const byte alarmSong[] PROGMEM = {
+	0x9a, 0x06, 42, 6,
+	88, 0x34, 95, 0x34, 93, 0x34, 95, 0x34, 98, 0x34, 93, 0xb4,
+};
+
+#define SONGS 1
+
+const byte *const songs[SONGS] PROGMEM = {
+	alarmSong,
+};
+
+#endif
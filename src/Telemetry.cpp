@@ -0,0 +1,141 @@
+#include "Telemetry.h"
+
+Telemetry::Telemetry(HardwareSerial &port) : _port(port)
+{
+	_head    = 0;
+	_tail    = 0;
+	_dropped = 0;
+}
+
+void Telemetry::sendTime(time_t t, byte status)
+{
+	byte *p = reserve(TELEMETRY_TIME);
+	if (!p)
+		return;
+
+	p[0] = t;
+	p[1] = t >> 8;
+	p[2] = t >> 16;
+	p[3] = t >> 24;
+	p[4] = status;
+	commit();
+}
+
+void Telemetry::sendTemperature(int sample, int filtered, byte level)
+{
+	byte *p = reserve(TELEMETRY_TEMPERATURE);
+	if (!p)
+		return;
+
+	p[0] = sample;
+	p[1] = sample >> 8;
+	p[2] = filtered;
+	p[3] = filtered >> 8;
+	p[4] = level;
+	commit();
+}
+
+void Telemetry::sendAlarm(byte index, byte hour, byte minute, byte flags, byte weekdays)
+{
+	byte *p = reserve(TELEMETRY_ALARM);
+	if (!p)
+		return;
+
+	p[0] = index;
+	p[1] = hour;
+	p[2] = minute;
+	p[3] = flags;
+	p[4] = weekdays;
+	commit();
+}
+
+void Telemetry::sendTransition(byte from, byte event, byte to, unsigned int us)
+{
+	byte *p = reserve(TELEMETRY_TRANSITION);
+	if (!p)
+		return;
+
+	p[0] = from;
+	p[1] = event;
+	p[2] = to;
+	p[3] = us;
+	p[4] = us >> 8;
+	commit();
+}
+
+void Telemetry::sendDuty(byte state, unsigned int permille, unsigned int ms)
+{
+	byte *p = reserve(TELEMETRY_DUTY);
+	if (!p)
+		return;
+
+	p[0] = state;
+	p[1] = permille;
+	p[2] = permille >> 8;
+	p[3] = ms;
+	p[4] = ms >> 8;
+	commit();
+}
+
+void Telemetry::sendStatus(byte code)
+{
+	byte *p = reserve(TELEMETRY_STATUS);
+	if (!p)
+		return;
+
+	p[0] = code;
+	commit();
+}
+
+void Telemetry::drain()
+{
+	while (_tail != _head && _port.availableForWrite() >= TELEMETRY_FRAME)
+	{
+		_port.write(_frames[_tail], TELEMETRY_FRAME);
+		_tail = (_tail + 1) & (TELEMETRY_RECORDS - 1);
+	}
+
+	// the loss is reported in order, once there is room again
+	if (_dropped)
+	{
+		unsigned int dropped = _dropped;
+		_dropped = 0;
+
+		byte *p = reserve(TELEMETRY_DROPPED);
+		if (!p)
+		{
+			_dropped = dropped;
+			return;
+		}
+
+		p[0] = dropped;
+		p[1] = dropped >> 8;
+		commit();
+	}
+}
+
+byte *Telemetry::reserve(byte type)
+{
+	if (((_head + 1) & (TELEMETRY_RECORDS - 1)) == _tail)
+	{
+		if (_dropped < 0xFFFF)
+			_dropped++;
+		return NULL;
+	}
+
+	byte *frame = _frames[_head];
+	frame[0] = TELEMETRY_SYNC;
+	frame[1] = type;
+	memset(frame + 2, 0, TELEMETRY_PAYLOAD);
+	return frame + 2;
+}
+
+void Telemetry::commit()
+{
+	byte *frame = _frames[_head];
+	frame[TELEMETRY_FRAME - 1] = telemetryCrc(frame + 1, TELEMETRY_PAYLOAD + 1);
+	_head = (_head + 1) & (TELEMETRY_RECORDS - 1);
+
+	// straight into the transmit buffer when it has room
+	drain();
+}
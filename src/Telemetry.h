@@ -0,0 +1,74 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+#include <Arduino.h>
+#include <Time.h>
+
+// Frames are TELEMETRY_SYNC, the record type, TELEMETRY_PAYLOAD bytes
+// and a CRC-8 of type and payload; numbers are little endian. The sync
+// byte never shows up in the ASCII text sharing the port, which is how
+// host/tools/mexclk-telemetry tells the two apart.
+#define TELEMETRY_SYNC    0xA5
+#define TELEMETRY_PAYLOAD 5
+#define TELEMETRY_FRAME   (TELEMETRY_PAYLOAD + 3)
+#define TELEMETRY_RECORDS 8 // queued frames, a power of two
+
+// record types, and their payloads
+#define TELEMETRY_TIME        1 // time_t, timeStatus()
+#define TELEMETRY_TEMPERATURE 2 // int sample, int filtered (0.01 C), sampling level
+#define TELEMETRY_ALARM       3 // index, hour, minute, TELEMETRY_ALARM_* flags, weekday mask
+#define TELEMETRY_TRANSITION  4 // from state, event, to state, unsigned int us
+#define TELEMETRY_DROPPED     5 // unsigned int records lost to a full queue
+#define TELEMETRY_DUTY        6 // state, unsigned int awake (0.1 %), unsigned int period (ms)
+#define TELEMETRY_STATUS      7 // TELEMETRY_STATUS_* code
+
+#define TELEMETRY_ALARM_ON     0x01
+#define TELEMETRY_ALARM_REPEAT 0x02
+
+#define TELEMETRY_STATUS_RTC_SYNCED 0 // setup() has the time from the RTC
+#define TELEMETRY_STATUS_RTC_FAILED 1 // setup() could not read it
+#define TELEMETRY_STATUS_ERROR      2 // ERROR_MODE, buttons and RTC alarm disabled
+
+// CRC-8, polynomial 0x07
+inline uint8_t telemetryCrc(const uint8_t *data, uint8_t length)
+{
+	uint8_t crc = 0;
+	while (length--)
+	{
+		crc ^= *data++;
+		for (uint8_t i = 0; i < 8; i++)
+			crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+	}
+	return crc;
+}
+
+// Fixed-size binary records queued in RAM and handed to the serial
+// port only as whole frames fit in its transmit buffer, from where its
+// data register empty interrupt sends them. Sending never blocks; a
+// full queue drops the record and reports the loss later.
+class Telemetry
+{
+	public:
+		Telemetry(HardwareSerial &port);
+		void sendTime(time_t t, byte status);
+		void sendTemperature(int sample, int filtered, byte level);
+		void sendAlarm(byte index, byte hour, byte minute, byte flags, byte weekdays);
+		void sendTransition(byte from, byte event, byte to, unsigned int us);
+		void sendDuty(byte state, unsigned int permille, unsigned int ms);
+		void sendStatus(byte code);
+		// moves queued frames into the transmit buffer, while they fit
+		void drain();
+
+	private:
+		HardwareSerial &_port;
+		byte _frames[TELEMETRY_RECORDS][TELEMETRY_FRAME];
+		byte _head;
+		byte _tail;
+		unsigned int _dropped;
+
+		// payload of a new frame, NULL when the queue is full
+		byte *reserve(byte type);
+		// seals the reserved frame with its CRC and queues it
+		void commit();
+};
+
+#endif